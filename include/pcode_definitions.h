@@ -4,6 +4,8 @@
 #include "vectype.h"
 
 machine_state *machine_state_init(char *network_name, uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size);
+machine_state *machine_state_init_concrete(uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size);
+machine_state *machine_state_init_stacks(machine_state *ms, uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size);
 void machine_state_free(machine_state *ms);
 
 //pcode function definitions
@@ -16,6 +18,8 @@ Vector *pINT_DIV(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_REM(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_SDIV(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_SREM(machine_state *ms, Vector *input0, Vector *input1);
+void pINT_DIVREM(machine_state *ms, Vector *input0, Vector *input1, Vector **quotient, Vector **remainder);
+void pINT_SDIVREM(machine_state *ms, Vector *input0, Vector *input1, Vector **quotient, Vector **remainder);
 Vector *pINT_OR(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_XOR(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_AND(machine_state *ms, Vector *input0, Vector *input1);
@@ -24,6 +28,7 @@ Vector *pINT_RIGHT(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_SRIGHT(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_EQUAL(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_NOTEQUAL(machine_state *ms, Vector *input0, Vector *input1);
+Vector *pINT_COMPARE(machine_state *ms, Vector *input0, Vector *input1, uint8_t pred);
 Vector *pINT_LESS(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_LESSEQUAL(machine_state *ms, Vector *input0, Vector *input1);
 Vector *pINT_CARRY(machine_state *ms, Vector *input0, Vector *input1);
@@ -15,9 +15,54 @@
 
 #define WORD_BITS 64
 #define BITS_IN_BYTE 8
-#define NUM_VECS_TO_CREATE 100
+#define NUM_VECS_TO_CREATE 100 //Most vectors of one width created at a time when its stack is empty
 #define SYMBOLIC_MEMORY_SIZE 20
+#define CMEM_PAGE_BITS 12 //cMemory cells are allocated a page of 2^CMEM_PAGE_BITS bytes at a time, on first store
+#define CMEM_PAGE_SIZE (1 << CMEM_PAGE_BITS)
+#define CMEM_DIRTY_WORDS (CMEM_PAGE_SIZE / 64) //uint64_t words of one page's dirty-byte bitmap
 #define REALLOC_DELTA 100 //Used for resizing (realloc'ing) arrays
+#define VEC_SLAB_BYTES 65536 //Size of one slab of Vectors
+#define VEC_SLAB_ALIGN 16    //Vectors are carved from slabs in multiples of this many bytes
+#define VEC_SOLO_BYTES (VEC_SLAB_BYTES/16) //Vectors larger than this are malloc'd on their own so they can be trimmed
+#define VEC_POOL_BUDGET (64*VEC_SLAB_BYTES) //Default bytes of idle vectors garbage_collect_ntk leaves in the pool
+#define VEC_ADDER_RIPPLE 0      //Ripple carry: fewest nodes, depth linear in the width
+#define VEC_ADDER_KOGGE_STONE 1 //Prefix carries, depth log2(width) but about width*log2(width) nodes
+#define VEC_ADDER_BRENT_KUNG 2  //Prefix carries, depth about 2*log2(width) and about 2*width nodes
+#define VEC_MULT_ARRAY 0        //Shift-add rows, one adder per multiplier bit
+#define VEC_MULT_WALLACE 1      //Carry-save Wallace tree and a final prefix adder
+#define VEC_MEMO_SIZE 4096      //Slots in the operation memo cache, a power of two
+#define VEC_OFFSET_SIZE 256     //Slots in the rewriter's table of base+constant sums, a power of two
+#define VEC_OP_ADD 1            //Word-level operations, for the memo cache and the rewriter
+#define VEC_OP_SUB 2
+#define VEC_OP_CARRY 3
+#define VEC_OP_MULT 4
+#define VEC_OP_AND 5
+#define VEC_OP_OR 6
+#define VEC_OP_XOR 7
+#define VEC_OP_CMP 9            //Memo entry only: the VEC_CMP_FLAGS flags of x-y
+#define VEC_CMP_CF 0            //Borrow out of x-y, x < y unsigned (see vec_compare)
+#define VEC_CMP_ZF 1            //x == y
+#define VEC_CMP_SF 2            //Sign bit of x-y
+#define VEC_CMP_OF 3            //x-y overflows as signed
+#define VEC_CMP_FLAGS 4         //Flags computed by vec_compare_flags; the predicates below are derived
+#define VEC_CMP_ULE 4
+#define VEC_CMP_SLT 5
+#define VEC_CMP_SLE 6
+#define VEC_RULE_SELF 0         //Rewrite rules, bits of ms->vec_rules: x-x, x^x, x&x, x|x, ite(c,x,x), x compared with x
+#define VEC_RULE_UNIT 1         //An operand of 0, 1 or all ones decides the result
+#define VEC_RULE_OFFSET 2       //(a+c1)+c2 -> a+(c1+c2), x-c -> x+(-c); see vec_offset_note
+#define VEC_RULE_SLICE 3        //Term slices of slices, constants and concatenations (zext(x)[0:n] -> x)
+#define VEC_RULE_COUNT 4
+#define VEC_RULES_ALL ((1 << VEC_RULE_COUNT) - 1)
+#define VEC_TERM_CONST 1        //Word-level term nodes (see vec_force); leaf, a constant of at most WORD_BITS bits
+#define VEC_TERM_BITS 2         //Leaf, the literals of an already bit-blasted vector
+#define VEC_TERM_ADD 3
+#define VEC_TERM_SUB 4
+#define VEC_TERM_MULT 5
+#define VEC_TERM_ITE 6          //Condition literal in .aux
+#define VEC_TERM_EXTRACT 7      //Start bit in .aux
+#define VEC_TERM_CAT 8          //args[0] is the high part, args[1] the low part
+#define VEC_LIMBS(num_bits) (((num_bits) + WORD_BITS - 1) / WORD_BITS) //Words needed to hold 'num_bits' concrete bits
 
 typedef uint32_t Gia_Lit_t;
 typedef uint32_t Gia_Probe_t;
@@ -25,26 +70,94 @@ typedef uint32_t Gia_Probe_t;
 struct timeval tv1;
 struct timezone tzp1;
 
+//Literal array shared copy-on-write between vectors (see vec_copy, vec_view)
+typedef struct {
+  uintmax_t refs;        //Number of vectors whose .symWord points at .lits
+  Gia_Lit_t lits[];
+} vec_shared_lits;
+
+#ifdef VEC_POOL_STATS
+//Vector pool counters for one vector width (build with -DVEC_POOL_STATS)
+typedef struct {
+  uintmax_t gets;        //Vectors handed out by vec_get
+  uintmax_t releases;    //Vectors returned by vec_release
+  uintmax_t refills;     //Times the stack was empty and a batch of vectors was allocated
+  uintmax_t live;        //Vectors currently in use
+  uintmax_t live_max;    //High-water mark of .live
+} vec_width_stats;
+
+//Vector pool counters for one vec_get/vec_getConstant/vec_dup call site
+typedef struct {
+  const char *file;
+  const char *func;
+  uintmax_t line;
+  uintmax_t gets;
+  uintmax_t live;
+  uintmax_t live_max;
+} vec_site_stats;
+#endif
+
 typedef struct {
   Gia_Lit_t *symWord;     //Of size WORD_BITS, indexed from 0..(.size-1)
   uintmax_t conWord;     //If .isSymbolic is false then this is the vector's value
+  uintmax_t *conWords;   //Concrete value as VEC_LIMBS(.size) words, least significant first; points at .conWord when .size <= WORD_BITS
   uintmax_t size;        //Number of bits of the vector
   unsigned isSymbolic:1; //True if the vector is symbolic, false if the vector is concrete
   unsigned inuse:1;      //False if the vector is in the stack, true if it is in use.
+  unsigned scoped:1;     //True if the vector will be released by the innermost open vec_scope_end
+  vec_shared_lits *shared; //Non-NULL when .symWord points into literals shared with other vectors
+  uintmax_t term;        //Non-zero while the vector is a word-level term whose literals are not built yet (see vec_force)
+#ifdef VEC_POOL_STATS
+  uintmax_t site;        //Index into ms->vecSites of the call that handed this vector out
+#endif
+  Gia_Lit_t lits[];      //Inline storage for .symWord, allocated along with the vector
 } Vector;
 
+//A word-level operation already built into the AIG (see vec_memo_lookup)
+typedef struct {
+  uintmax_t hash;
+  uintmax_t op;          //VEC_OP_*, with the adder and multiplier selection it was built with
+  uintmax_t x_size;
+  uintmax_t y_size;
+  uintmax_t r_size;
+  Gia_Lit_t *lits;       //x's, then y's, then the result's literals; NULL if the slot is empty
+} vec_memo_entry;
+
+//Hash-consed word-level operation, bit-blasted on demand by vec_force
+typedef struct {
+  uint8_t op;            //VEC_TERM_*
+  uintmax_t size;        //Width of the result
+  uintmax_t args[2];     //Operand terms
+  uintmax_t aux;         //Constant value, ITE condition or EXTRACT start bit
+  uintmax_t hash;
+  Gia_Lit_t *lits;       //Literals of the result, NULL until lowered
+} vec_term;
+
+//Vectors are carved out of large slabs, one bump allocator per size class
+typedef struct {
+  uint8_t *cursor;       //Next free byte in the current slab of this class
+  uintmax_t remaining;   //Bytes left in the current slab of this class
+} vec_slab_class;
+
 //cMemory
 typedef struct {
-  //Symbolic Values
-  Vector *value;
+  Vector *value;       //NULL while the byte is concrete, see cMemoryPage.bytes
   Gia_Lit_t writtenTo; //Read-before-write error
-  //Probes
-  Gia_Probe_t *valueProbes;
-  Gia_Probe_t writtenToProbe;
 } cMemoryCell;
 
 typedef struct {
-  cMemoryCell *cByte;
+  cMemoryCell cByte[CMEM_PAGE_SIZE];
+  uint8_t bytes[CMEM_PAGE_SIZE]; //Values of the bytes whose cell has no vector
+  uintmax_t refs;        //cMemories sharing the page; a store into a shared page copies it first
+  uintmax_t flag;        //CurrsMemFlag of the last root walk, so a shared page is walked once
+} cMemoryPage;
+
+typedef struct {
+  cMemoryPage **pages;   //NULL in concrete-only mode; a NULL page was never stored to and reads as unwritten zeros
+  uintmax_t num_pages;
+  uint64_t **dirty;      //Per page, a bitmap of the bytes stored to since the branch (NULL if none); see cMemory_ite
+  uint8_t *bytes;        //Concrete-only mode: the memory's contents
+  uint8_t *written;      //Concrete-only mode: nonzero once a byte has been stored to
   uintmax_t size;
   uintmax_t base_address;
 } cMemory;
@@ -55,18 +168,13 @@ typedef struct {
   //Symbolic Values
   Vector *value;
   Vector *address;
-  //Probes
-  Gia_Probe_t *valueProbes;
-  Gia_Probe_t *addressProbes;
 } sMemoryCell;
 
 typedef struct sMemoryStruct {
   uintmax_t memoized_flag;
   Vector *memoized_value;
-  Gia_Probe_t *memoized_value_probes;
 
   Gia_Lit_t writtenTo; //Read-before-write error
-  Gia_Probe_t writtenToProbe;
   
   uintmax_t head;
   uint8_t address_size;
@@ -74,7 +182,6 @@ typedef struct sMemoryStruct {
   sMemoryCell *sByteArray;
   
   Gia_Lit_t c;
-  Gia_Probe_t cProbe;
 
   struct sMemoryStruct *sMemT;
   struct sMemoryStruct *sMemF;
@@ -93,14 +200,52 @@ typedef struct {
 
 typedef struct {
   Gia_Man_t *ntk;
+  uint8_t concrete_only;           //Set by machine_state_init_concrete: no sweeper, probes, or inputs
   
   uintmax_t vecs_allocated;
   uintmax_t vecs_in_stack;
   uintmax_t vectorStack_size;
   void_arr_stack **vectorStack;
+  uintmax_t *vecPrefill;           //Size of the last batch created per width, 0 if none yet
+  uintmax_t vec_pool_budget;       //Idle bytes vec_pool_trim keeps when called from garbage_collect_ntk
+  void_arr_stack *vecSlabs;        //Every slab allocated, free'd in bulk
+  vec_slab_class *vecSlabClass;    //Indexed by vector byte size / VEC_SLAB_ALIGN
+  uintmax_t vecSlabClass_size;
+  uint8_t vec_cow;                 //When set, vec_copy/vec_dup share literals copy-on-write
+  uint8_t vec_adder;               //VEC_ADDER_* carry chain built by vec_add, vec_sub, vec_carry, vec_compare and pINT_SCARRY
+  uint8_t vec_multiplier;          //VEC_MULT_* circuit built by vec_mult for two symbolic operands
+  uint8_t vec_memo;                //When set, vec_add, vec_sub, vec_carry, vec_compare and vec_mult reuse results for the same operands
+  vec_memo_entry *vecMemo;         //VEC_MEMO_SIZE slots, allocated on first store
+  vec_memo_entry vecCmpLast;       //The last fused compare, kept even with vec_memo off (see vec_compare_flags)
+  uintmax_t vec_memo_hits;
+  uintmax_t vec_memo_misses;
+  uintmax_t vec_memo_flushes;      //Times the cache was emptied (every garbage_collect_ntk)
+  uint8_t vec_lazy;                //When set, add, sub, mult, ite, slices and concatenations build terms instead of gates
+  vec_term *vecTerms;              //Index 0 is unused
+  uintmax_t vecTerms_head;
+  uintmax_t vecTerms_size;
+  uintmax_t *vecTermHash;          //Open addressed (term index + 1), 0 is empty
+  uintmax_t vecTermHash_size;      //Power of two
+  uintmax_t vecTermEpoch;          //Bumped by vec_term_flush; stale term ids are caught by vec_force
+  uintmax_t vec_terms_made;
+  uintmax_t vec_terms_reused;      //Requests answered by an existing term
+  uintmax_t vec_terms_lowered;
+  uintmax_t vec_rules;             //VEC_RULE_* bits the rewriter may apply
+  uintmax_t vec_rule_hits[VEC_RULE_COUNT];
+  vec_memo_entry *vecOffsets;      //VEC_OFFSET_SIZE bit-blasted sums of a base and a constant (see vec_offset_note), allocated on first note
+  void_arr_stack *vecScope;        //Vectors handed out while a scope is open
+  void_arr_stack *vecScopeMarks;   //Head of .vecScope at each vec_scope_begin
+#ifdef VEC_POOL_STATS
+  vec_width_stats *vecWidthStats;  //Indexed by width, .vectorStack_size entries
+  vec_site_stats *vecSites;
+  uintmax_t vecSites_head;
+  uintmax_t vecSites_size;
+  uintmax_t *vecSiteHash;          //Open addressed (site index + 1), 0 is empty
+  uintmax_t vecSiteHash_size;      //Power of two
+  uintmax_t vecs_live_max;         //High-water mark of vectors in use
+#endif
 
   Vector *vec_zero_byte;
-  Gia_Probe_t *vec_zero_byte_probes;
 
   void_arr_stack *conditions_stack;
 
@@ -109,12 +254,15 @@ typedef struct {
   uintmax_t nNodes_increment;
   Vec_Int_t *gc_probes;
   uintmax_t next_gc_probe;
+  void_arr_stack *gcRootVecs;      //Vectors kept through the collection in progress
+  Vec_Int_t *gcRootVecProbes;      //One probe per literal of .gcRootVecs, in order
+  void_arr_stack *gcRootLits;      //Literals (Gia_Lit_t *) kept through the collection in progress
+  Vec_Int_t *gcRootLitProbes;      //One probe per entry of .gcRootLits
 
   uint8_t branch_error;
   uintmax_t stackframe_depth;
 
   Vector *heap_offset;
-  Gia_Probe_t *heap_offset_probes;
 
   uintmax_t CurrsMemFlag;
   void_arr_stack *sMemStack;       //Needed for sMemory reads
@@ -132,7 +280,11 @@ typedef struct {
 
 //Symbolic Vector Routines
 
+void vec_slabs_init(machine_state *ms);
+void vec_slabs_free(machine_state *ms);
 void vec_free(machine_state *ms, Vector *vec);
+uintmax_t vec_prefill_count(machine_state *ms, uintmax_t num_bits);
+uintmax_t vec_pool_trim(machine_state *ms, uintmax_t budget);
 void vec_verify(machine_state *ms, Vector *vec);
 Vector *vec_get(machine_state *ms, uintmax_t num_bits);
 void vec_setValue(machine_state *ms, Vector *vec, uintmax_t value);
@@ -142,7 +294,15 @@ Vector **vec_getArray(machine_state *ms, uintmax_t num_arr_elements, uintmax_t n
 Vector **vec_getConstantArray(machine_state *ms, uintmax_t value, uintmax_t num_arr_elements, uintmax_t num_element_bits);
 void vec_release(machine_state *ms, Vector *vec);
 void vec_releaseArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_elements);
+void vec_scope_begin(machine_state *ms);
+void vec_scope_end(machine_state *ms);
+Vector *vec_scope_keep(machine_state *ms, Vector *vec);
 void vec_copy(machine_state *ms, Vector *dst, Vector *src);
+void vec_copy_private(machine_state *ms, Vector *dst, Vector *src);
+void vec_own(machine_state *ms, Vector *vec);
+void vec_unshare(machine_state *ms, Vector *vec);
+void vec_share(machine_state *ms, Vector *dst, Vector *src, uintmax_t start);
+uint8_t vec_view(machine_state *ms, Vector *dst, Vector *src, uintmax_t start);
 Vector *vec_dup(machine_state *ms, Vector *src);
 void vec_setAsInput(machine_state *ms, Vector *vec, char name[1024]);
 Vector *vec_getInput(machine_state *ms, uintmax_t num_element_bits, char name[1024]);
@@ -155,19 +315,83 @@ Vector *vec_joinArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_e
 Vector **vec_splitIntoNewArray(machine_state *ms, Vector *vec, uintmax_t num_arr_elements);
 void vec_splitIntoArray(machine_state *ms, Vector *vec, Vector **vec_array, uintmax_t num_arr_elements);
 
+#ifdef VEC_POOL_STATS
+//Instrumented pool: every vector is attributed to the line that asked for it
+void vec_pool_stats_init(machine_state *ms);
+void vec_pool_stats_free(machine_state *ms);
+uintmax_t vec_pool_site(machine_state *ms, const char *file, const char *func, uintmax_t line);
+void vec_pool_report(machine_state *ms, FILE *out);
+void vec_pool_report_leaks(machine_state *ms, FILE *out);
+Vector *vec_get_at(machine_state *ms, uintmax_t num_bits, const char *file, const char *func, uintmax_t line);
+Vector *vec_getConstant_at(machine_state *ms, uintmax_t value, uintmax_t num_bits, const char *file, const char *func, uintmax_t line);
+Vector *vec_dup_at(machine_state *ms, Vector *src, const char *file, const char *func, uintmax_t line);
+#define vec_get(ms, num_bits) vec_get_at(ms, num_bits, __FILE__, __func__, __LINE__)
+#define vec_getConstant(ms, value, num_bits) vec_getConstant_at(ms, value, num_bits, __FILE__, __func__, __LINE__)
+#define vec_dup(ms, src) vec_dup_at(ms, src, __FILE__, __func__, __LINE__)
+#endif
+
+//Operation memo cache
+
+uintmax_t vec_memo_hash(uintmax_t op, Vector *x, Vector *y);
+uint8_t vec_memo_match(Gia_Lit_t *lits, Vector *vec);
+uint8_t vec_memo_lookup(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Gia_Lit_t *result, uintmax_t n);
+void vec_memo_store(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Gia_Lit_t *result, uintmax_t n);
+uint8_t vec_memo_find(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Vector *ret);
+Vector *vec_memo_save(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Vector *ret);
+void vec_memo_flush(machine_state *ms);
+void vec_memo_free(machine_state *ms);
+void vec_memo_report(machine_state *ms, FILE *out);
+
+//Word-level terms, lowered to literals on demand
+
+void vec_term_init(machine_state *ms);
+void vec_term_flush(machine_state *ms);
+void vec_term_free(machine_state *ms);
+uintmax_t vec_term_node(machine_state *ms, uint8_t op, uintmax_t size, uintmax_t a, uintmax_t b, uintmax_t aux);
+uintmax_t vec_term_of(machine_state *ms, Vector *vec);
+Gia_Lit_t *vec_term_lits(machine_state *ms, uintmax_t term);
+void vec_term_set(machine_state *ms, Vector *vec, uintmax_t term);
+Vector *vec_term_get(machine_state *ms, uintmax_t term);
+uint8_t vec_term_offset(machine_state *ms, uintmax_t term, uintmax_t *base, uintmax_t *offset);
+uint8_t vec_term_wanted(machine_state *ms, Vector *x, Vector *y);
+Vector *vec_term_binary(machine_state *ms, uint8_t op, Vector *x, Vector *y);
+void vec_force(machine_state *ms, Vector *vec);
+void vec_term_report(machine_state *ms, FILE *out);
+
+//Word-level rewriting, before any gates are built
+
+void vec_rewrite_init(machine_state *ms);
+uint8_t vec_rule_fire(machine_state *ms, uintmax_t rule);
+uint8_t vec_same(machine_state *ms, Vector *x, Vector *y);
+Vector *vec_rewrite_binary(machine_state *ms, uintmax_t op, Vector *x, Vector *y);
+void vec_offset_note(machine_state *ms, Vector *x, Vector *y, Vector *ret);
+void vec_offset_flush(machine_state *ms);
+void vec_offset_free(machine_state *ms);
+void vec_rewrite_report(machine_state *ms, FILE *out);
+
 // Transformations between probes and vectors
 
 Gia_Probe_t get_probe_from_lit(machine_state *ms, Gia_Lit_t lit);
 void update_probe_from_lit(machine_state *ms, Gia_Probe_t probe, Gia_Lit_t lit);
 Gia_Lit_t get_lit_from_probe(machine_state *ms, Gia_Probe_t probe);
 void probe_free(machine_state *ms, Gia_Probe_t probe);
-Gia_Probe_t *get_probes_from_vec(machine_state *ms, Vector *vec);
-void update_probes_from_vec(machine_state *ms, Gia_Probe_t *probes, Vector *vec);
-void update_vec_from_probes(machine_state *ms, Gia_Probe_t *probes, Vector *vec);
-Vector *get_vec_from_probes(machine_state *ms, Gia_Probe_t *probes, uintmax_t size);
-void probes_free(machine_state *ms, Gia_Probe_t *probes, uintmax_t size);
 void collect_probe(machine_state *ms, Gia_Probe_t probe);
-void collect_probes(machine_state *ms, Gia_Probe_t *probes, uintmax_t size);
+
+//Garbage collection roots, probed only while a collection runs
+
+void gc_roots_init(machine_state *ms);
+void gc_roots_free(machine_state *ms);
+void gc_root_vec(machine_state *ms, Vector *vec, uint8_t collect);
+void gc_root_lit(machine_state *ms, Gia_Lit_t *lit, uint8_t collect);
+void gc_roots_restore(machine_state *ms);
+
+//Literal array scans (SIMD when built for AVX2 or SSE4.1)
+
+uint8_t lits_all_const(const Gia_Lit_t *lits, uintmax_t n);
+void lits_pack(const Gia_Lit_t *lits, uintmax_t n, uintmax_t *mask, uintmax_t *value);
+void lits_unpack(Gia_Lit_t *lits, uintmax_t n, uintmax_t value);
+uint8_t lits_equal(const Gia_Lit_t *a, const Gia_Lit_t *b, uintmax_t n);
+uint8_t lits_any_complement(const Gia_Lit_t *a, const Gia_Lit_t *b, uintmax_t n);
 
 // Transformations between symbolic and concrete vectors
 
@@ -175,6 +399,18 @@ void vec_sym_to_con(machine_state *ms, Vector *vec);
 uint8_t vec_sym_to_con_attempt(machine_state *ms, Vector *vec);
 uint8_t vec_concretize_with_SAT(machine_state *ms, Vector *vec);
 
+//Concrete values wider than WORD_BITS
+
+uintmax_t vec_con_getbits(Vector *vec, uintmax_t start, uintmax_t n);
+void vec_con_setbits(Vector *vec, uintmax_t start, uintmax_t n, uintmax_t value);
+void vec_con_fillbits(Vector *vec, uintmax_t start, uintmax_t n, uint8_t bit);
+void vec_con_copybits(Vector *dst, uintmax_t dst_start, Vector *src, uintmax_t src_start, uintmax_t n);
+void vec_con_clear(Vector *vec);
+void vec_con_trim(Vector *vec);
+uint8_t vec_con_equal(Vector *x, Vector *y);
+uintmax_t vec_con_mod(Vector *vec, uintmax_t m);
+uintmax_t vec_con_saturate(Vector *vec);
+
 //Functions for printing vectors
 
 void vec_printSimple(machine_state *ms, Vector *vec);
@@ -185,6 +421,10 @@ void vec_printArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_ele
 //Vector manipulation routines
 
 uintmax_t int_zextend(uintmax_t, uintmax_t x_size);
+uintmax_t int_lsb_index(uintmax_t x);
+uintmax_t int_msb_index(uintmax_t x);
+uintmax_t int_reverse(uintmax_t x);
+void vec_known_bits(Vector *vec, uintmax_t *mask, uintmax_t *value);
 Vector *vec_zextend(machine_state *ms, Vector *x, uintmax_t result_size);
 uintmax_t int_sextend(uintmax_t x, uintmax_t x_size, uintmax_t result_size);
 Vector *vec_sextend(machine_state *ms, Vector *x, uintmax_t result_size);
@@ -197,6 +437,11 @@ Vector *vec_xor(machine_state *ms, Vector *x, Vector *y);
 uint8_t vec_sym_equal(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_equal(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_equal_SAT(machine_state *ms, Vector *x, Vector *y, uint8_t call_SAT_solver);
+Gia_Lit_t lit_equal_SAT(machine_state *ms, Gia_Lit_t x, Gia_Lit_t y, uint8_t call_SAT_solver);
+uintmax_t vec_find_unequal(machine_state *ms, Vector **x, Vector **y, uintmax_t n);
+uintmax_t lit_find_unequal(machine_state *ms, Gia_Lit_t *x, Gia_Lit_t *y, uintmax_t n);
+int lit_depth(machine_state *ms, Gia_Lit_t lit);
+int vec_depth(machine_state *ms, Vector *x);
 Vector *vec_negate(machine_state *ms, Vector *x);
 Vector *vec_invert(machine_state *ms, Vector *x);
 Vector *vec_ite(machine_state *ms, Gia_Lit_t c, Vector *x, Vector *y);
@@ -205,6 +450,7 @@ Gia_Lit_t vec_greaterthan(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_signed_greaterthan(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_lessthan(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_signed_lessthan(machine_state *ms, Vector *x, Vector *y);
+Vector *vec_barrel_shift(machine_state *ms, Vector *x, Vector *amount, uint8_t left, uint8_t rotate, Gia_Lit_t fill);
 Vector *vec_shiftright(machine_state *ms, Vector *x, Vector *amount);
 Vector *vec_signedshiftright(machine_state *ms, Vector *x, Vector *amount);
 Vector *vec_shiftleft(machine_state *ms, Vector *x, Vector *amount);
@@ -212,11 +458,22 @@ Vector *vec_rotateright(machine_state *ms, Vector *x, Vector *amount);
 Vector *vec_rotateleft(machine_state *ms, Vector *x, Vector *amount);
 Vector *vec_selectBits(machine_state *ms, Vector *x, uint16_t num_bits, uint16_t bit_offset);
 Vector *vec_reverse(machine_state *ms, Vector *x);
+Gia_Lit_t vec_prefix_add(machine_state *ms, Gia_Lit_t *sum, Gia_Lit_t *x, Gia_Lit_t *y, uintmax_t n, Gia_Lit_t carry, uint8_t invert_y);
 Vector *vec_add(machine_state *ms, Vector *x, Vector *y);
 Gia_Lit_t vec_carry(machine_state *ms, Vector *x, Vector *y);
+Gia_Lit_t vec_sub_lits(machine_state *ms, Gia_Lit_t *diff, Vector *x, Vector *y, Gia_Lit_t *borrow_top);
 Vector *vec_sub(machine_state *ms, Vector *x, Vector *y);
+void vec_compare_flags(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t *flags);
+Gia_Lit_t vec_compare(machine_state *ms, Vector *x, Vector *y, uint8_t pred);
+Vector *vec_mult_const(machine_state *ms, Vector *x, Vector *c);
+Vector *vec_mult_high_const(machine_state *ms, Vector *x, Vector *c);
+Vector *vec_mult_wallace(machine_state *ms, Vector *x, Vector *y);
 Vector *vec_mult(machine_state *ms, Vector *x, Vector *y);
+void vec_divmod_const(machine_state *ms, Vector *x, Vector *d, Vector **quot, Vector **rem);
+void vec_sdivmod_const(machine_state *ms, Vector *x, Vector *d, Vector **quot, Vector **rem);
+void vec_divmod(machine_state *ms, Vector *x, Vector *y, Vector **quot, Vector **rem);
 Vector *vec_quot_rem(machine_state *ms, Vector *x, Vector *y, uint8_t quot_rem);
+void vec_sdivmod(machine_state *ms, Vector *x, Vector *y, Vector **quot, Vector **rem);
 
 //Routines for handling concretely addressed memory
 
@@ -230,9 +487,8 @@ Vector *cMemory_load_be(machine_state *ms, uintmax_t address, uintmax_t size);
 Gia_Lit_t cMemory_load_rbw(machine_state *ms, uintmax_t address, uintmax_t size);
 cMemory *cMemory_ite(machine_state *ms, Gia_Lit_t c, cMemory *cMemT, cMemory *cMemF);
 cMemory *cMemory_copy(machine_state *ms, cMemory *cMem);
-void cMemory_update_probes(machine_state *ms, cMemory *cMem);
-void cMemory_update_from_probes(machine_state *ms, cMemory *cMem);
-void cMemory_collect_probes(machine_state *ms, cMemory *cMem);
+void cMemory_clean(machine_state *ms, cMemory *cMem);
+void cMemory_gc_roots(machine_state *ms, cMemory *cMem, uint8_t collect);
 
 //Routined for handling symbolically addressed memory
 
@@ -253,9 +509,7 @@ Vector **sMemory_loadArray_be(machine_state *ms, Vector *address, uintmax_t numA
 sMemory *sMemory_ite(machine_state *ms, Gia_Lit_t c, sMemory *sMemT, sMemory *sMemF);
 sMemory *sMemory_copy(machine_state *ms, sMemory *sMem);
 void sMemory_compress(machine_state *ms, sMemory *sMem);
-void sMemory_update_probes(machine_state *ms, sMemory *sMem);
-void sMemory_update_from_probes(machine_state *ms, sMemory *sMem);
-void sMemory_collect_probes(machine_state *ms, sMemory *sMem);
+void sMemory_gc_roots(machine_state *ms, sMemory *sMem, uint8_t collect);
 
 //Constant check functions (calls to the SAT solver)
 
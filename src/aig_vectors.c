@@ -2,28 +2,238 @@
 
 //Symbolic Vector Routines
 
-Vector *alloc_vector(uintmax_t num_bits) {
-  Vector *new_vec = (Vector *)malloc(sizeof(Vector));
-  new_vec->symWord = (Gia_Lit_t *)calloc(num_bits, sizeof(Gia_Lit_t ));
+void vec_slabs_init(machine_state *ms) {
+  ms->vecSlabs = arr_stack_init();
+  ms->vecSlabClass_size = 0;
+  ms->vecSlabClass = NULL;
+}
+
+//Free every slab at once; all vectors carved from them are gone afterwards.
+void vec_slabs_free(machine_state *ms) {
+  while(ms->vecSlabs->head != 0)
+    free(arr_stack_pop(ms->vecSlabs));
+  arr_stack_free(ms->vecSlabs);
+  free(ms->vecSlabClass);
+  ms->vecSlabClass = NULL;
+  ms->vecSlabClass_size = 0;
+}
+
+#ifdef VEC_POOL_STATS
+void vec_pool_stats_init(machine_state *ms) {
+  ms->vecWidthStats = (vec_width_stats *)calloc(ms->vectorStack_size, sizeof(vec_width_stats));
+  ms->vecSites_head = 0;
+  ms->vecSites_size = REALLOC_DELTA;
+  ms->vecSites = (vec_site_stats *)malloc(ms->vecSites_size * sizeof(vec_site_stats));
+  ms->vecSiteHash_size = 256;
+  ms->vecSiteHash = (uintmax_t *)calloc(ms->vecSiteHash_size, sizeof(uintmax_t));
+  ms->vecs_live_max = 0;
+}
+
+void vec_pool_stats_free(machine_state *ms) {
+  free(ms->vecWidthStats);
+  ms->vecWidthStats = NULL;
+  free(ms->vecSites);
+  ms->vecSites = NULL;
+  free(ms->vecSiteHash);
+  ms->vecSiteHash = NULL;
+}
+
+uintmax_t vec_pool_site_slot(machine_state *ms, const char *file, uintmax_t line) {
+  uintmax_t h = (((uintptr_t)file >> 3) * 31 + line) & (ms->vecSiteHash_size - 1);
+  while(ms->vecSiteHash[h] != 0) {
+    vec_site_stats *ss = &ms->vecSites[ms->vecSiteHash[h] - 1];
+    if(ss->line == line && ss->file == file) break;
+    h = (h + 1) & (ms->vecSiteHash_size - 1);
+  }
+  return h;
+}
+
+//Index of the call site (file, line) in ms->vecSites, added on first use.
+//__FILE__ strings are compared by address, which is enough to tell sites apart.
+uintmax_t vec_pool_site(machine_state *ms, const char *file, const char *func, uintmax_t line) {
+  uintmax_t i;
+  uintmax_t h = vec_pool_site_slot(ms, file, line);
+  if(ms->vecSiteHash[h] != 0) return ms->vecSiteHash[h] - 1;
+
+  if(ms->vecSites_head == ms->vecSites_size) {
+    ms->vecSites_size += REALLOC_DELTA;
+    ms->vecSites = (vec_site_stats *)realloc(ms->vecSites, ms->vecSites_size * sizeof(vec_site_stats));
+  }
+  vec_site_stats *ss = &ms->vecSites[ms->vecSites_head];
+  ss->file = file;
+  ss->func = func;
+  ss->line = line;
+  ss->gets = 0;
+  ss->live = 0;
+  ss->live_max = 0;
+  ms->vecSiteHash[h] = ++ms->vecSites_head;
+
+  if(2*ms->vecSites_head > ms->vecSiteHash_size) {
+    //Keep the table at most half full
+    free(ms->vecSiteHash);
+    ms->vecSiteHash_size *= 2;
+    ms->vecSiteHash = (uintmax_t *)calloc(ms->vecSiteHash_size, sizeof(uintmax_t));
+    for(i = 0; i < ms->vecSites_head; i++)
+      ms->vecSiteHash[vec_pool_site_slot(ms, ms->vecSites[i].file, ms->vecSites[i].line)] = i+1;
+  }
+  return ms->vecSites_head - 1;
+}
+
+//Per-width and per-call-site counters, for tuning the pool's batch sizes
+void vec_pool_report(machine_state *ms, FILE *out) {
+  uintmax_t i;
+  fprintf(out, "Vector pool: allocated=%ju, in use=%ju, in use high-water=%ju\n",
+	  ms->vecs_allocated, ms->vecs_allocated - ms->vecs_in_stack, ms->vecs_live_max);
+  fprintf(out, "%8s %12s %12s %8s %10s %10s\n", "width", "gets", "releases", "refills", "live", "live_max");
+  for(i = 0; i < ms->vectorStack_size; i++) {
+    vec_width_stats *ws = &ms->vecWidthStats[i];
+    if(ws->gets == 0) continue;
+    fprintf(out, "%8ju %12ju %12ju %8ju %10ju %10ju\n", i, ws->gets, ws->releases, ws->refills, ws->live, ws->live_max);
+  }
+  fprintf(out, "%12s %10s %10s  %s\n", "gets", "live", "live_max", "site");
+  for(i = 0; i < ms->vecSites_head; i++) {
+    vec_site_stats *ss = &ms->vecSites[i];
+    fprintf(out, "%12ju %10ju %10ju  %s:%ju (%s)\n", ss->gets, ss->live, ss->live_max, ss->file, ss->line, ss->func);
+  }
+  fflush(out);
+}
+
+//Allocation sites of every vector not yet released
+void vec_pool_report_leaks(machine_state *ms, FILE *out) {
+  uintmax_t i;
+  for(i = 0; i < ms->vecSites_head; i++) {
+    vec_site_stats *ss = &ms->vecSites[i];
+    if(ss->live == 0) continue;
+    fprintf(out, "  %ju Vector(s) from %s:%ju (%s)\n", ss->live, ss->file, ss->line, ss->func);
+  }
+  fflush(out);
+}
+#endif
+
+//Byte offset of the concrete words of a vector wider than WORD_BITS,
+//which follow its inline literals
+uintmax_t vec_limbs_offset(uintmax_t num_bits) {
+  uintmax_t bytes = sizeof(Vector) + (num_bits * sizeof(Gia_Lit_t));
+  return (bytes + (sizeof(uintmax_t)-1)) & ~((uintmax_t)(sizeof(uintmax_t)-1));
+}
+
+//Bytes needed for a vector of 'num_bits' bits, rounded up to the slab alignment
+uintmax_t vec_slab_bytes(uintmax_t num_bits) {
+  uintmax_t bytes = sizeof(Vector) + (num_bits * sizeof(Gia_Lit_t));
+  if(num_bits > WORD_BITS)
+    bytes = vec_limbs_offset(num_bits) + (VEC_LIMBS(num_bits) * sizeof(uintmax_t));
+  return (bytes + (VEC_SLAB_ALIGN-1)) & ~((uintmax_t)(VEC_SLAB_ALIGN-1));
+}
+
+Vector *alloc_vector(machine_state *ms, uintmax_t num_bits) {
+  uintmax_t i;
+  Vector *new_vec;
+  uintmax_t bytes = vec_slab_bytes(num_bits);
+  if(bytes > VEC_SOLO_BYTES) {
+    //Wide vectors are allocated on their own so that vec_pool_trim can free them
+    new_vec = (Vector *)malloc(bytes);
+  } else {
+    uintmax_t c = bytes / VEC_SLAB_ALIGN;
+    if(c >= ms->vecSlabClass_size) {
+      ms->vecSlabClass = (vec_slab_class *)realloc((void *)ms->vecSlabClass, (c + REALLOC_DELTA) * sizeof(vec_slab_class));
+      for(i = ms->vecSlabClass_size; i < c+REALLOC_DELTA; i++) {
+	ms->vecSlabClass[i].cursor = NULL;
+	ms->vecSlabClass[i].remaining = 0;
+      }
+      ms->vecSlabClass_size = c+REALLOC_DELTA;
+    }
+    
+    vec_slab_class *slab_class = &ms->vecSlabClass[c];
+    if(slab_class->remaining < bytes) {
+      //Current slab is exhausted, start a new one
+      uintmax_t slab_bytes = VEC_SLAB_BYTES - (VEC_SLAB_BYTES % bytes);
+      slab_class->cursor = (uint8_t *)malloc(slab_bytes);
+      slab_class->remaining = slab_bytes;
+      arr_stack_push(ms->vecSlabs, (void *)slab_class->cursor);
+    }
+    new_vec = (Vector *)slab_class->cursor;
+    slab_class->cursor += bytes;
+    slab_class->remaining -= bytes;
+  }
+
+  new_vec->symWord = new_vec->lits;
+  new_vec->shared = NULL;
+  new_vec->term = 0;
+  memset(new_vec->symWord, 0, num_bits * sizeof(Gia_Lit_t));
   new_vec->conWord = 0;
+  if(num_bits > WORD_BITS) {
+    new_vec->conWords = (uintmax_t *)((uint8_t *)new_vec + vec_limbs_offset(num_bits));
+    memset(new_vec->conWords, 0, VEC_LIMBS(num_bits) * sizeof(uintmax_t));
+  } else new_vec->conWords = &new_vec->conWord;
   new_vec->size = num_bits;
   new_vec->isSymbolic = 0;
   new_vec->inuse = 0;
+  new_vec->scoped = 0;
   return new_vec;
 }
 
+//Vectors carved from slabs are reclaimed by vec_slabs_free; only wide
+//vectors, allocated on their own, are free'd here.
 void vec_free(machine_state *ms, Vector *vec) {
-  free(vec->symWord);
-  free(vec);   
+  (void)ms;
+  if(vec_slab_bytes(vec->size) > VEC_SOLO_BYTES)
+    free(vec);
+}
+
+//Number of vectors to create when the stack of 'num_bits' vectors is
+//empty. A width's first batch is capped at one slab's worth of bytes so a
+//lone wide temporary stays cheap; each refill after that doubles the
+//batch, up to NUM_VECS_TO_CREATE.
+uintmax_t vec_prefill_count(machine_state *ms, uintmax_t num_bits) {
+  uintmax_t n = ms->vecPrefill[num_bits];
+  if(n == 0) {
+    n = VEC_SLAB_BYTES / vec_slab_bytes(num_bits);
+    if(n == 0) n = 1;
+  } else n *= 2;
+  if(n > NUM_VECS_TO_CREATE) n = NUM_VECS_TO_CREATE;
+  ms->vecPrefill[num_bits] = n;
+  return n;
+}
+
+//Free idle wide vectors, widest first, until at most 'budget' bytes of
+//idle vectors remain pooled. Vectors carved from slabs are never free'd
+//individually. Returns the number of bytes given back.
+uintmax_t vec_pool_trim(machine_state *ms, uintmax_t budget) {
+  uintmax_t i;
+  uintmax_t idle = 0, freed = 0;
+  //The records of an open scope may still point at idle vectors
+  if(ms->vecScopeMarks->head != 0) return 0;
+
+  for(i = 0; i < ms->vectorStack_size; i++)
+    idle += ms->vectorStack[i]->head * vec_slab_bytes(i);
+
+  for(i = ms->vectorStack_size; i-- > 0 && idle > budget; ) {
+    uintmax_t bytes = vec_slab_bytes(i);
+    if(bytes <= VEC_SOLO_BYTES) break; //This and all narrower widths are slab carved
+    if(ms->vectorStack[i]->head == 0) continue;
+    while(ms->vectorStack[i]->head != 0 && idle > budget) {
+      vec_free(ms, (Vector *)arr_stack_pop(ms->vectorStack[i]));
+      ms->vecs_allocated--;
+      ms->vecs_in_stack--;
+      idle -= bytes;
+      freed += bytes;
+    }
+    //Demand for this width was overestimated, refill it in smaller batches
+    ms->vecPrefill[i] = (ms->vecPrefill[i] + 1) / 2;
+  }
+  return freed;
 }
 
 void vec_verify(machine_state *ms, Vector *vec) {
   uintmax_t i;
   if(vec == NULL) return;
   assert(vec->size > 0);
-  assert(vec->size <= WORD_BITS || vec->isSymbolic == 1);
   assert(vec->inuse == 1);
-  if(vec->isSymbolic == 1) {
+  if(vec->isSymbolic == 0 && vec->size > WORD_BITS && (vec->size % WORD_BITS) != 0) {
+    //Bits above .size in the top word are kept clear
+    assert((vec->conWords[VEC_LIMBS(vec->size)-1] >> (vec->size % WORD_BITS)) == 0);
+  }
+  if(vec->isSymbolic == 1 && vec->term == 0) {
     assert(vec->symWord != NULL);
     for(i = 0; i < vec->size; i++) {
       Gia_Obj_t *node = Gia_ObjFromLit(ms->ntk, vec->symWord[i]);
@@ -34,50 +244,88 @@ void vec_verify(machine_state *ms, Vector *vec) {
 }
 
 void vec_setValue(machine_state *ms, Vector *vec, uintmax_t value) {
-  uintmax_t i;
+  vec_unshare(ms, vec);
   vec->conWord = value;
-  for(i = 0; i < vec->size; i++) {
-    if((value&1) == 0)
-      vec->symWord[i] = Gia_ManConst0Lit();
-    else
-      vec->symWord[i] = Gia_ManConst1Lit();
-    value>>=1;
-  }
-  if(vec->size > WORD_BITS)
-    vec->isSymbolic = 1;
-  else vec->isSymbolic = 0;
+  if(vec->size > WORD_BITS) {
+    vec_con_clear(vec);
+    vec->conWords[0] = value;
+    lits_unpack(vec->symWord, WORD_BITS, value);
+    memset(vec->symWord + WORD_BITS, 0, (vec->size - WORD_BITS) * sizeof(Gia_Lit_t)); //Gia_ManConst0Lit()
+  } else lits_unpack(vec->symWord, vec->size, value);
+  vec->isSymbolic = 0;
 }
 
+//Fill in the (constant) literals of a concrete vector; it stays concrete.
 void vec_calc_sym(machine_state *ms, Vector *vec) {
+  uintmax_t i;
   assert(!vec->isSymbolic);
-  vec_setValue(ms, vec, vec->conWord);
+  if(vec->size <= WORD_BITS) {
+    vec_setValue(ms, vec, vec->conWord);
+    return;
+  }
+  vec_unshare(ms, vec);
+  for(i = 0; i < vec->size; i += WORD_BITS)
+    lits_unpack(vec->symWord + i, (vec->size - i < WORD_BITS) ? vec->size - i : WORD_BITS, vec->conWords[i / WORD_BITS]);
 }
 
+#ifdef VEC_POOL_STATS
+Vector *vec_get_at(machine_state *ms, uintmax_t num_bits, const char *file, const char *func, uintmax_t line) {
+#else
 Vector *vec_get(machine_state *ms, uintmax_t num_bits) {
+#endif
   uintmax_t i;
   if(num_bits >= ms->vectorStack_size) {
     ms->vectorStack = (void_arr_stack **)realloc((void *)ms->vectorStack, (num_bits + REALLOC_DELTA) * sizeof(void_arr_stack *));
-    for(i = ms->vectorStack_size; i < num_bits+REALLOC_DELTA; i++)
+    ms->vecPrefill = (uintmax_t *)realloc((void *)ms->vecPrefill, (num_bits + REALLOC_DELTA) * sizeof(uintmax_t));
+    for(i = ms->vectorStack_size; i < num_bits+REALLOC_DELTA; i++) {
       ms->vectorStack[i] = arr_stack_init();
+      ms->vecPrefill[i] = 0;
+    }
+#ifdef VEC_POOL_STATS
+    ms->vecWidthStats = (vec_width_stats *)realloc((void *)ms->vecWidthStats, (num_bits + REALLOC_DELTA) * sizeof(vec_width_stats));
+    memset(ms->vecWidthStats + ms->vectorStack_size, 0, (num_bits + REALLOC_DELTA - ms->vectorStack_size) * sizeof(vec_width_stats));
+#endif
     ms->vectorStack_size = num_bits+REALLOC_DELTA;
   }
   if(ms->vectorStack[num_bits]->head == 0) {
     //Stack is empty, populate it with new vectors
-    for(i = 0; i < NUM_VECS_TO_CREATE; i++)
-      arr_stack_push(ms->vectorStack[num_bits], (void *)alloc_vector(num_bits));
-    ms->vecs_allocated+=NUM_VECS_TO_CREATE;
-    ms->vecs_in_stack+=NUM_VECS_TO_CREATE;
+    uintmax_t n = vec_prefill_count(ms, num_bits);
+    for(i = 0; i < n; i++)
+      arr_stack_push(ms->vectorStack[num_bits], (void *)alloc_vector(ms, num_bits));
+    ms->vecs_allocated+=n;
+    ms->vecs_in_stack+=n;
+#ifdef VEC_POOL_STATS
+    ms->vecWidthStats[num_bits].refills++;
+#endif
   }
   Vector *new_vec = (Vector *)arr_stack_pop(ms->vectorStack[num_bits]);
   ms->vecs_in_stack--;
   assert(new_vec->inuse == 0);
   new_vec->inuse = 1;
+  new_vec->scoped = (ms->vecScopeMarks->head != 0);
+  if(new_vec->scoped)
+    arr_stack_push(ms->vecScope, (void *)new_vec);
+#ifdef VEC_POOL_STATS
+  vec_width_stats *ws = &ms->vecWidthStats[num_bits];
+  ws->gets++;
+  if(++ws->live > ws->live_max) ws->live_max = ws->live;
+  new_vec->site = vec_pool_site(ms, file, func, line);
+  vec_site_stats *ss = &ms->vecSites[new_vec->site];
+  ss->gets++;
+  if(++ss->live > ss->live_max) ss->live_max = ss->live;
+  if(ms->vecs_allocated - ms->vecs_in_stack > ms->vecs_live_max)
+    ms->vecs_live_max = ms->vecs_allocated - ms->vecs_in_stack;
+#endif
   return new_vec;
 }
 
+#ifdef VEC_POOL_STATS
+Vector *vec_getConstant_at(machine_state *ms, uintmax_t value, uintmax_t num_bits, const char *file, const char *func, uintmax_t line) {
+  Vector *new_vec = vec_get_at(ms, num_bits, file, func, line);
+#else
 Vector *vec_getConstant(machine_state *ms, uintmax_t value, uintmax_t num_bits) {
-  assert(num_bits <= WORD_BITS);
   Vector *new_vec = vec_get(ms, num_bits);
+#endif
   vec_setValue(ms, new_vec, value);
   return new_vec;
 }
@@ -91,7 +339,6 @@ Vector **vec_getArray(machine_state *ms, uintmax_t num_arr_elements, uintmax_t n
 }
 
 Vector **vec_getConstantArray(machine_state *ms, uintmax_t value, uintmax_t num_arr_elements, uintmax_t num_element_bits) {
-  assert(num_element_bits <= WORD_BITS);
   uintmax_t i;
   Vector **vec_array = (Vector **)malloc(num_arr_elements * sizeof(Vector *));
   for(i = 0; i < num_arr_elements; i++)
@@ -101,7 +348,13 @@ Vector **vec_getConstantArray(machine_state *ms, uintmax_t value, uintmax_t num_
 
 void vec_release(machine_state *ms, Vector *vec) {
   assert(vec->inuse == 1);
+  vec_unshare(ms, vec);
   vec->inuse = 0;
+#ifdef VEC_POOL_STATS
+  ms->vecWidthStats[vec->size].releases++;
+  ms->vecWidthStats[vec->size].live--;
+  ms->vecSites[vec->site].live--;
+#endif
   arr_stack_push(ms->vectorStack[vec->size], (void *)vec);
   ms->vecs_in_stack++;   
 }
@@ -114,18 +367,137 @@ void vec_releaseArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_e
   free(vec_array);
 }
 
+//Open a region; every vector handed out until the matching vec_scope_end
+//is released by it unless promoted with vec_scope_keep. Regions nest.
+void vec_scope_begin(machine_state *ms) {
+  arr_stack_push_uintmax(ms->vecScopeMarks, ms->vecScope->head);
+}
+
+//Release, in one batch, the vectors of the innermost region that are
+//still in use. Vectors released by hand (and possibly handed out again)
+//may appear more than once, so only those still marked scoped are released.
+void vec_scope_end(machine_state *ms) {
+  assert(ms->vecScopeMarks->head != 0);
+  uintmax_t mark = arr_stack_pop_uintmax(ms->vecScopeMarks);
+  while(ms->vecScope->head > mark) {
+    Vector *vec = (Vector *)arr_stack_pop(ms->vecScope);
+    if(vec->inuse && vec->scoped)
+      vec_release(ms, vec);
+  }
+}
+
+//Detach 'vec' from every open region; the caller now owns it and must
+//release it by hand.
+Vector *vec_scope_keep(machine_state *ms, Vector *vec) {
+  assert(vec->inuse == 1);
+  vec->scoped = 0;
+  return vec;
+}
+
+//Drop 'vec's reference to shared literals (and any term), leaving it with
+//its own (uninitialized) inline literals. Used before overwriting every literal.
+void vec_unshare(machine_state *ms, Vector *vec) {
+  vec->term = 0;
+  if(vec->shared == NULL) return;
+  assert(vec->shared->refs > 0);
+  vec->shared->refs--;
+  if(vec->shared->refs == 0) free(vec->shared);
+  vec->shared = NULL;
+  vec->symWord = vec->lits;
+}
+
+//Make 'vec' the only owner of its literals so they can be written in place.
+void vec_own(machine_state *ms, Vector *vec) {
+  vec_force(ms, vec);
+  if(vec->shared == NULL || vec->shared->refs == 1) return;
+  memcpy(vec->lits, vec->symWord, vec->size * sizeof(Gia_Lit_t ));
+  vec_unshare(ms, vec);
+}
+
+//Copy 'src' into 'dst' such that 'dst' owns its literals, for callers
+//that go on to write dst->symWord.
+void vec_copy_private(machine_state *ms, Vector *dst, Vector *src) {
+  assert(src->size == dst->size);
+  vec_force(ms, src);
+  if(dst == src) {
+    vec_own(ms, dst);
+    return;
+  }
+  vec_unshare(ms, dst);
+  memcpy(dst->symWord, src->symWord, src->size * sizeof(Gia_Lit_t ));
+  dst->conWord    = src->conWord;
+  if(src->size > WORD_BITS)
+    memcpy(dst->conWords, src->conWords, VEC_LIMBS(src->size) * sizeof(uintmax_t));
+  dst->isSymbolic = src->isSymbolic;
+  dst->inuse      = src->inuse;
+}
+
+//Point 'dst' at src's literals from bit 'start' on, for dst->size bits,
+//moving src's literals out of its inline storage on first share.
+void vec_share(machine_state *ms, Vector *dst, Vector *src, uintmax_t start) {
+  assert(start + dst->size <= src->size);
+  vec_force(ms, src);
+  if(src->shared == NULL) {
+    src->shared = (vec_shared_lits *)malloc(sizeof(vec_shared_lits) + (src->size * sizeof(Gia_Lit_t )));
+    src->shared->refs = 1;
+    memcpy(src->shared->lits, src->lits, src->size * sizeof(Gia_Lit_t ));
+    src->symWord = src->shared->lits;
+  }
+  if(dst->symWord == src->symWord + start) return;
+  vec_unshare(ms, dst);
+  src->shared->refs++;
+  dst->shared = src->shared;
+  dst->symWord = src->symWord + start;
+}
+
+//With ms->vec_cow set, a slice of a symbolic vector (vec_trunc,
+//vec_extract, vec_selectBits, vec_splitIntoNewArray, pSUBPIECE) is a
+//view of the parent's literals rather than a copy.
+uint8_t vec_view(machine_state *ms, Vector *dst, Vector *src, uintmax_t start) {
+  if(!ms->vec_cow || !src->isSymbolic) return 0;
+  vec_share(ms, dst, src, start);
+  if(vec_sym_to_con_attempt(ms, dst))
+    vec_unshare(ms, dst);
+  else dst->isSymbolic = 1;
+  return 1;
+}
+
+//With ms->vec_cow set, symbolic literals are shared rather than copied
+//and concrete vectors copy only .conWord (literals are rebuilt by
+//vec_calc_sym when needed). Writers must call vec_own first.
 inline
 void vec_copy(machine_state *ms, Vector *dst, Vector *src) {
+  if(src->term != 0) {
+    //A term is shared by id, whatever ms->vec_cow says
+    assert(src->size == dst->size);
+    if(dst != src) vec_term_set(ms, dst, src->term);
+    return;
+  }
+  if(!ms->vec_cow) {
+    vec_copy_private(ms, dst, src);
+    return;
+  }
   assert(src->size == dst->size);
-  memcpy(dst->symWord, src->symWord, src->size * sizeof(Gia_Lit_t ));
+  if(dst == src) return;
+  dst->term = 0;
+  if(src->isSymbolic) {
+    vec_share(ms, dst, src, 0);
+  } else if(src->size > WORD_BITS) {
+    memcpy(dst->conWords, src->conWords, VEC_LIMBS(src->size) * sizeof(uintmax_t));
+  }
   dst->conWord    = src->conWord;
   dst->isSymbolic = src->isSymbolic;
   dst->inuse      = src->inuse;
 }
 
 inline
+#ifdef VEC_POOL_STATS
+Vector *vec_dup_at(machine_state *ms, Vector *src, const char *file, const char *func, uintmax_t line) {
+  Vector *dst = vec_get_at(ms, src->size, file, func, line);
+#else
 Vector *vec_dup(machine_state *ms, Vector *src) {
   Vector *dst = vec_get(ms, src->size);
+#endif
   vec_copy(ms, dst, src);
   return dst;
 }
@@ -134,10 +506,17 @@ void vec_setAsInput(machine_state *ms, Vector *vec, char name[1024]) {
   char *buf;
   intmax_t i;
 
+  if(ms->concrete_only) {
+    fprintf(stdout, "Error: Symbolic input '%s' in concrete-only mode...exiting\n", name);
+    assert(0);
+    exit(0);
+  }
+
   if(ms->ntk->vNamesIn == NULL) {
     ms->ntk->vNamesIn = Vec_PtrAlloc(100);
   }
 
+  vec_unshare(ms, vec);
   vec->isSymbolic = 1;
   //Big bit endian
   for(i = vec->size-1; i >= 0; i--) {
@@ -175,9 +554,12 @@ Vector **vec_getInputArray(machine_state *ms, uintmax_t num_arr_elements, uintma
 }
 
 void vec_setAsOutput(machine_state *ms, Vector *vec, char name[1024]) {
+  vec_force(ms, vec);
   char *buf;
   intmax_t i;
 
+  if(ms->concrete_only) return; //There is no AIG to add outputs to
+
   if(!vec->isSymbolic)
     vec_calc_sym(ms, vec);
 
@@ -213,124 +595,265 @@ void vec_removeLastNOutputs(machine_state *ms, uintmax_t n) {
   }
 }
 
+//Operation memo cache. Structural hashing dedupes single AND gates, but a
+//recurring word-level operation (address+1 in every byte of a load, the
+//flags of one compare) would still walk and hash its whole circuit again.
+//Each slot holds the operand and result literals of one operation; a
+//colliding store replaces it. Literals only stay valid until the next
+//garbage collection, which empties the cache.
+
+//The operation together with the circuit choices that shape its result
+uintmax_t vec_memo_op(machine_state *ms, uintmax_t op) {
+  return op | (((uintmax_t)ms->vec_adder) << 8) | (((uintmax_t)ms->vec_multiplier) << 16);
+}
+
+//Literal of bit i of an operand; concrete operands may not have theirs filled in
+Gia_Lit_t vec_memo_lit(Vector *vec, uintmax_t i) {
+  if(vec->isSymbolic) return vec->symWord[i];
+  return vec_con_getbits(vec, i, 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+}
+
+uintmax_t vec_memo_hash(uintmax_t op, Vector *x, Vector *y) {
+  uintmax_t i;
+  uint64_t h = 0xcbf29ce484222325ULL; //FNV-1a
+  h = (h ^ op) * 0x100000001b3ULL;
+  h = (h ^ x->size) * 0x100000001b3ULL;
+  h = (h ^ y->size) * 0x100000001b3ULL;
+  for(i = 0; i < x->size; i++)
+    h = (h ^ vec_memo_lit(x, i)) * 0x100000001b3ULL;
+  for(i = 0; i < y->size; i++)
+    h = (h ^ vec_memo_lit(y, i)) * 0x100000001b3ULL;
+  return h;
+}
+
+uint8_t vec_memo_match(Gia_Lit_t *lits, Vector *vec) {
+  uintmax_t i;
+  if(vec->isSymbolic) return lits_equal(lits, vec->symWord, vec->size);
+  for(i = 0; i < vec->size; i++)
+    if(lits[i] != vec_memo_lit(vec, i)) return 0;
+  return 1;
+}
+
+//Copy the n result literals of a previous 'op' on x and y into 'result'.
+//Returns 0, leaving 'result' alone, if there is none.
+uint8_t vec_memo_lookup(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Gia_Lit_t *result, uintmax_t n) {
+  if(!ms->vec_memo) return 0;
+  if(ms->vecMemo == NULL) {
+    ms->vec_memo_misses++;
+    return 0;
+  }
+  op = vec_memo_op(ms, op);
+  uintmax_t h = vec_memo_hash(op, x, y);
+  vec_memo_entry *e = &ms->vecMemo[h & (VEC_MEMO_SIZE-1)];
+  if(e->lits == NULL || e->hash != h || e->op != op ||
+     e->x_size != x->size || e->y_size != y->size || e->r_size != n ||
+     !vec_memo_match(e->lits, x) || !vec_memo_match(e->lits + x->size, y)) {
+    ms->vec_memo_misses++;
+    return 0;
+  }
+  memcpy(result, e->lits + x->size + y->size, n * sizeof(Gia_Lit_t));
+  ms->vec_memo_hits++;
+  return 1;
+}
+
+//Record the n result literals of 'op' on x and y
+void vec_memo_store(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Gia_Lit_t *result, uintmax_t n) {
+  uintmax_t i;
+  if(!ms->vec_memo) return;
+  if(ms->vecMemo == NULL)
+    ms->vecMemo = (vec_memo_entry *)calloc(VEC_MEMO_SIZE, sizeof(vec_memo_entry));
+  op = vec_memo_op(ms, op);
+  uintmax_t h = vec_memo_hash(op, x, y);
+  vec_memo_entry *e = &ms->vecMemo[h & (VEC_MEMO_SIZE-1)];
+  uintmax_t total = x->size + y->size + n;
+  if(e->lits == NULL || e->x_size + e->y_size + e->r_size != total)
+    e->lits = (Gia_Lit_t *)realloc(e->lits, total * sizeof(Gia_Lit_t));
+  e->hash = h;
+  e->op = op;
+  e->x_size = x->size;
+  e->y_size = y->size;
+  e->r_size = n;
+  for(i = 0; i < x->size; i++)
+    e->lits[i] = vec_memo_lit(x, i);
+  for(i = 0; i < y->size; i++)
+    e->lits[x->size + i] = vec_memo_lit(y, i);
+  memcpy(e->lits + x->size + y->size, result, n * sizeof(Gia_Lit_t));
+}
+
+//Fill 'ret' with the result of a previous 'op' on x and y, if there is one
+uint8_t vec_memo_find(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Vector *ret) {
+  if(!ms->vec_memo) return 0;
+  vec_unshare(ms, ret);
+  if(!vec_memo_lookup(ms, op, x, y, ret->symWord, ret->size)) return 0;
+  if(!vec_sym_to_con_attempt(ms, ret))
+    ret->isSymbolic = 1;
+  return 1;
+}
+
+//Record 'ret' as the result of 'op' on x and y and return it. Concrete
+//results are cheap to rebuild and are not kept.
+Vector *vec_memo_save(machine_state *ms, uintmax_t op, Vector *x, Vector *y, Vector *ret) {
+  if(ret->isSymbolic)
+    vec_memo_store(ms, op, x, y, ret->symWord, ret->size);
+  return ret;
+}
+
+//Forget every recorded operation, for when literals are renumbered
+void vec_memo_flush(machine_state *ms) {
+  uintmax_t i;
+  free(ms->vecCmpLast.lits);
+  ms->vecCmpLast.lits = NULL;
+  if(ms->vecMemo == NULL) return;
+  for(i = 0; i < VEC_MEMO_SIZE; i++) {
+    free(ms->vecMemo[i].lits);
+    ms->vecMemo[i].lits = NULL;
+  }
+  ms->vec_memo_flushes++;
+}
+
+void vec_memo_free(machine_state *ms) {
+  vec_memo_flush(ms);
+  free(ms->vecMemo);
+  ms->vecMemo = NULL;
+}
+
+void vec_memo_report(machine_state *ms, FILE *out) {
+  uintmax_t lookups = ms->vec_memo_hits + ms->vec_memo_misses;
+  fprintf(out, "Operation memo: hits=%ju, misses=%ju (%.1f%% hit), flushes=%ju\n",
+	  ms->vec_memo_hits, ms->vec_memo_misses,
+	  (lookups == 0) ? 0.0 : (100.0 * ms->vec_memo_hits) / lookups, ms->vec_memo_flushes);
+  fflush(out);
+}
+
 // Transformations between probes and vectors
 
 inline
 Gia_Probe_t get_probe_from_lit(machine_state *ms, Gia_Lit_t lit) {
+  if(ms->concrete_only) return 0; //No sweeper, so no probes
   return Gia_SweeperProbeCreate(ms->ntk, lit);
 }
 
 inline
 void update_probe_from_lit(machine_state *ms, Gia_Probe_t probe, Gia_Lit_t lit) {
+  if(ms->concrete_only) return;
   Gia_SweeperProbeUpdate(ms->ntk, probe, lit);
 }
 
 inline
 Gia_Lit_t get_lit_from_probe(machine_state *ms, Gia_Probe_t probe) {
+  assert(!ms->concrete_only);
   return Gia_SweeperProbeLit(ms->ntk, probe);
 }
 
 inline
 void probe_free(machine_state *ms, Gia_Probe_t probe) {
+  if(ms->concrete_only) return;
   Gia_SweeperProbeDelete(ms->ntk, probe);
 }
 
-inline
-Gia_Probe_t *get_probes_from_vec(machine_state *ms, Vector *vec) {
-  uintmax_t i;
-  if(!vec->isSymbolic) vec_calc_sym(ms, vec);
-  Gia_Probe_t *probes = (Gia_Probe_t *)malloc(vec->size * sizeof(Gia_Probe_t));
-  for(i = 0; i < vec->size; i++) {
-    probes[i] = get_probe_from_lit(ms, vec->symWord[i]);
-  }
-  return probes;
+void collect_probe(machine_state *ms, Gia_Probe_t probe) {
+  Vec_IntPush(ms->gc_probes, probe);
+  //fprintf(stdout, "[%d -> %d]", probe, get_lit_from_probe(ms, probe));
 }
 
-inline
-void update_probes_from_vec(machine_state *ms, Gia_Probe_t *probes, Vector *vec) {
-  uintmax_t i;
-  if(!vec->isSymbolic) vec_calc_sym(ms, vec);
-  for(i = 0; i < vec->size; i++) {
-    update_probe_from_lit(ms, probes[i], vec->symWord[i]);
-  }
-}
+// Garbage collection roots
+//
+//Memory holds no probes between collections. garbage_collect_ntk registers
+//everything it has to keep with gc_root_vec and gc_root_lit, which probe it
+//into a flat table, and gc_roots_restore reads the literals back once the
+//sweep is done and deletes the probes. Constant literals are the same in
+//any network, so concrete vectors and constant literals are not roots.
 
-inline
-void update_vec_from_probes(machine_state *ms, Gia_Probe_t *probes, Vector *vec) {
-  uintmax_t i;
-  for(i = 0; i < vec->size; i++) {
-    vec->symWord[i] = get_lit_from_probe(ms, probes[i]);
-  }
-  vec->isSymbolic = 1;
-  vec_sym_to_con_attempt(ms, vec);
+void gc_roots_init(machine_state *ms) {
+  ms->gcRootVecs = arr_stack_init();
+  ms->gcRootVecProbes = Vec_IntAlloc(0);
+  ms->gcRootLits = arr_stack_init();
+  ms->gcRootLitProbes = Vec_IntAlloc(0);
 }
 
-inline
-Vector *get_vec_from_probes(machine_state *ms, Gia_Probe_t *probes, uintmax_t size) {
-  Vector *vec = vec_get(ms, size);
-  update_vec_from_probes(ms, probes, vec);
-  return vec;  
+void gc_roots_free(machine_state *ms) {
+  assert(ms->gcRootVecs->head == 0 && ms->gcRootLits->head == 0);
+  arr_stack_free(ms->gcRootVecs);
+  Vec_IntFree(ms->gcRootVecProbes);
+  arr_stack_free(ms->gcRootLits);
+  Vec_IntFree(ms->gcRootLitProbes);
 }
 
-inline
-void probes_free(machine_state *ms, Gia_Probe_t *probes, uintmax_t size) {
+//Keep 'vec' through the collection in progress; 'collect' also hands its
+//probes to the sweeper
+void gc_root_vec(machine_state *ms, Vector *vec, uint8_t collect) {
   uintmax_t i;
-  for(i = 0; i < size; i++)
-    probe_free(ms, probes[i]);
-  free(probes);
+  vec_force(ms, vec);
+  if(ms->concrete_only || !vec->isSymbolic) return;
+  arr_stack_push(ms->gcRootVecs, (void *)vec);
+  for(i = 0; i < vec->size; i++) {
+    Gia_Probe_t probe = get_probe_from_lit(ms, vec->symWord[i]);
+    Vec_IntPush(ms->gcRootVecProbes, probe);
+    if(collect) collect_probe(ms, probe);
+  }
 }
 
-void collect_probe(machine_state *ms, Gia_Probe_t probe) {
-  Vec_IntPush(ms->gc_probes, probe);
-  //fprintf(stdout, "[%d -> %d]", probe, get_lit_from_probe(ms, probe));
+void gc_root_lit(machine_state *ms, Gia_Lit_t *lit, uint8_t collect) {
+  if(ms->concrete_only || *lit == Gia_ManConst0Lit() || *lit == Gia_ManConst1Lit()) return;
+  arr_stack_push(ms->gcRootLits, (void *)lit);
+  Gia_Probe_t probe = get_probe_from_lit(ms, *lit);
+  Vec_IntPush(ms->gcRootLitProbes, probe);
+  if(collect) collect_probe(ms, probe);
 }
 
-inline
-void collect_probes(machine_state *ms, Gia_Probe_t *probes, uintmax_t size) {
-  uintmax_t i;
-  for(i = 0; i < size; i++) {
-    collect_probe(ms, probes[i]);
+//Every root takes the literals its probes now point to, and the probes are
+//deleted. A root registered twice is simply written twice.
+void gc_roots_restore(machine_state *ms) {
+  uintmax_t i, j, k;
+
+  for(j = 0, k = 1; k <= ms->gcRootVecs->head; k++) {
+    Vector *vec = (Vector *)ms->gcRootVecs->mem[k];
+    vec_unshare(ms, vec);
+    for(i = 0; i < vec->size; i++)
+      vec->symWord[i] = get_lit_from_probe(ms, Vec_IntEntry(ms->gcRootVecProbes, j++));
+    vec->isSymbolic = 1;
+    vec_sym_to_con_attempt(ms, vec);
   }
+  assert(j == (uintmax_t)Vec_IntSize(ms->gcRootVecProbes));
+  for(k = 1; k <= ms->gcRootLits->head; k++)
+    *(Gia_Lit_t *)ms->gcRootLits->mem[k] = get_lit_from_probe(ms, Vec_IntEntry(ms->gcRootLitProbes, k-1));
+
+  for(j = 0; j < (uintmax_t)Vec_IntSize(ms->gcRootVecProbes); j++)
+    probe_free(ms, Vec_IntEntry(ms->gcRootVecProbes, j));
+  for(j = 0; j < (uintmax_t)Vec_IntSize(ms->gcRootLitProbes); j++)
+    probe_free(ms, Vec_IntEntry(ms->gcRootLitProbes, j));
+  Vec_IntClear(ms->gcRootVecProbes);
+  Vec_IntClear(ms->gcRootLitProbes);
+  ms->gcRootVecs->head = 0;
+  ms->gcRootLits->head = 0;
 }
 
 // Transformations between symbolic and concrete vectors
 
 void vec_sym_to_con(machine_state *ms, Vector *vec) {
-  intmax_t i; //Must be a signed integer
-  assert(vec->size <= WORD_BITS);
-  assert(Gia_ManIsConstLit(vec->symWord[vec->size-1]));
-  uint8_t torf = Gia_ManIsConst1Lit(vec->symWord[vec->size-1]);
-  uintmax_t conWord = torf;
-  for(i = (vec->size)-2; i >= 0; i--) {
-    assert(Gia_ManIsConstLit(vec->symWord[i]));
-    conWord<<=1;
-    torf = Gia_ManIsConst1Lit(vec->symWord[i]);
-    conWord+=torf;      
-  }
-  vec->conWord = conWord;
+  uintmax_t i;
+  uintmax_t mask;
+  //.conWords is .conWord for narrow vectors, and the top limb is left clean
+  for(i = 0; i < vec->size; i += WORD_BITS) {
+    uintmax_t n = (vec->size - i < WORD_BITS) ? vec->size - i : WORD_BITS;
+    lits_pack(vec->symWord + i, n, &mask, &vec->conWords[i / WORD_BITS]);
+    assert(mask == int_zextend(~((uintmax_t)0), n)); (void)mask;
+  }
   vec->isSymbolic = 0;   
 }
 
 uint8_t vec_sym_to_con_attempt(machine_state *ms, Vector *vec) {
-  intmax_t i; //Must be a signed integer
-  if(vec->size > WORD_BITS) return 0;
-  if(!Gia_ManIsConstLit(vec->symWord[vec->size-1])) return 0;
-  uint8_t torf = Gia_ManIsConst1Lit(vec->symWord[vec->size-1]);
-  uintmax_t conWord = torf;
-  for(i = (vec->size)-2; i >= 0; i--) {
-    if(!Gia_ManIsConstLit(vec->symWord[i])) return 0;
-    conWord<<=1;
-    torf = Gia_ManIsConst1Lit(vec->symWord[i]);
-    conWord+=torf;      
-  }
-  vec->conWord = conWord;
-  vec->isSymbolic = 0;   
+  if(vec->term != 0) return 0; //No literals to look at yet
+  if(!lits_all_const(vec->symWord, vec->size)) return 0;
+  vec_sym_to_con(ms, vec);
   return 1;
 }
 
 uint8_t vec_concretize_with_SAT(machine_state *ms, Vector *vec) {
   uintmax_t i;
+  vec_force(ms, vec);
   if(vec->isSymbolic == 0) return 1;
+  vec_own(ms, vec);
   for(i = 0; i < vec->size; i++) {
     if(!Gia_ManIsConstLit(vec->symWord[i])) {
       if(is_node_constant(ms, vec->symWord[i], 0)) {
@@ -345,6 +868,90 @@ uint8_t vec_concretize_with_SAT(machine_state *ms, Vector *vec) {
   return vec_sym_to_con_attempt(ms, vec);
 }
 
+//Concrete values wider than WORD_BITS
+
+//Bits [start, start+n) of a concrete vector, 0 < n <= WORD_BITS
+uintmax_t vec_con_getbits(Vector *vec, uintmax_t start, uintmax_t n) {
+  assert(n > 0 && n <= WORD_BITS);
+  assert(start + n <= vec->size);
+  uintmax_t limb = start / WORD_BITS;
+  uintmax_t offset = start % WORD_BITS;
+  uintmax_t bits = vec->conWords[limb] >> offset;
+  if(offset != 0 && (offset + n) > WORD_BITS)
+    bits |= vec->conWords[limb+1] << (WORD_BITS - offset);
+  return int_zextend(bits, n);
+}
+
+//Set bits [start, start+n) of a concrete vector to the low n bits of 'value'
+void vec_con_setbits(Vector *vec, uintmax_t start, uintmax_t n, uintmax_t value) {
+  assert(n > 0 && n <= WORD_BITS);
+  assert(start + n <= vec->size);
+  uintmax_t limb = start / WORD_BITS;
+  uintmax_t offset = start % WORD_BITS;
+  uintmax_t mask = ((uintmax_t)~0)>>(WORD_BITS - n);
+  value &= mask;
+  vec->conWords[limb] = (vec->conWords[limb] & ~(mask << offset)) | (value << offset);
+  if(offset != 0 && (offset + n) > WORD_BITS) {
+    limb++;
+    mask >>= WORD_BITS - offset;
+    vec->conWords[limb] = (vec->conWords[limb] & ~mask) | (value >> (WORD_BITS - offset));
+  }
+}
+
+void vec_con_fillbits(Vector *vec, uintmax_t start, uintmax_t n, uint8_t bit) {
+  uintmax_t i, chunk;
+  for(i = 0; i < n; i += chunk) {
+    chunk = ((n - i) < WORD_BITS) ? (n - i) : WORD_BITS;
+    vec_con_setbits(vec, start + i, chunk, bit ? ~((uintmax_t)0) : 0);
+  }
+}
+
+void vec_con_copybits(Vector *dst, uintmax_t dst_start, Vector *src, uintmax_t src_start, uintmax_t n) {
+  uintmax_t i, chunk;
+  for(i = 0; i < n; i += chunk) {
+    chunk = ((n - i) < WORD_BITS) ? (n - i) : WORD_BITS;
+    vec_con_setbits(dst, dst_start + i, chunk, vec_con_getbits(src, src_start + i, chunk));
+  }
+}
+
+void vec_con_clear(Vector *vec) {
+  memset(vec->conWords, 0, VEC_LIMBS(vec->size) * sizeof(uintmax_t));
+}
+
+//Clear the bits above .size in the top word
+void vec_con_trim(Vector *vec) {
+  if((vec->size % WORD_BITS) == 0) return;
+  vec->conWords[VEC_LIMBS(vec->size)-1] &= ((uintmax_t)~0)>>(WORD_BITS - (vec->size % WORD_BITS));
+}
+
+uint8_t vec_con_equal(Vector *x, Vector *y) {
+  assert(x->size == y->size);
+  if(x->size <= WORD_BITS)
+    return int_zextend(x->conWord, x->size) == int_zextend(y->conWord, y->size);
+  return memcmp(x->conWords, y->conWords, VEC_LIMBS(x->size) * sizeof(uintmax_t)) == 0;
+}
+
+//vec mod m for a concrete vector of any width, m at most 2^32
+uintmax_t vec_con_mod(Vector *vec, uintmax_t m) {
+  intmax_t i;
+  assert(m != 0 && m <= ((uintmax_t)1) << 32);
+  if(vec->size <= WORD_BITS) return int_zextend(vec->conWord, vec->size) % m;
+  uintmax_t limb_mod = ((~((uintmax_t)0)) % m + 1) % m; //2^WORD_BITS mod m
+  uintmax_t r = 0;
+  for(i = VEC_LIMBS(vec->size)-1; i >= 0; i--)
+    r = (r * limb_mod + vec->conWords[i] % m) % m;
+  return r;
+}
+
+//Value of a concrete vector, or ~0 if it does not fit in a word (shift amounts)
+uintmax_t vec_con_saturate(Vector *vec) {
+  uintmax_t i;
+  if(vec->size <= WORD_BITS) return int_zextend(vec->conWord, vec->size);
+  for(i = 1; i < VEC_LIMBS(vec->size); i++)
+    if(vec->conWords[i] != 0) return ~((uintmax_t)0);
+  return vec->conWords[0];
+}
+
 
 //Functions for printing vectors
 
@@ -354,6 +961,10 @@ void vec_printSimple(machine_state *ms, Vector *vec) {
     for(i = 0; i < ((vec->size-1) / (BITS_IN_BYTE / 2))+1; i++) {
       fprintf(stdout, "#");
     }
+  } else if(vec->size > WORD_BITS) {
+    intmax_t l; //Must be a signed integer
+    for(l = VEC_LIMBS(vec->size)-1; l >= 0; l--)
+      fprintf(stdout, "%16.16jx", vec->conWords[l]);
   } else {
     fprintf(stdout, "%2.2jx", int_zextend(vec->conWord, vec->size));
   }
@@ -361,13 +972,22 @@ void vec_printSimple(machine_state *ms, Vector *vec) {
 
 void vec_print(machine_state *ms, Vector *vec) {
   uintmax_t i;
+  vec_force(ms, vec);
   if(vec->isSymbolic) {
     for(i = 0; i < vec->size; i++) {
       fprintf(stdout, "\nsymWord[%ju] = ", i);
       Gia_ObjPrint(ms->ntk, Gia_ObjFromLit(ms->ntk, vec->symWord[i]));
     }
   }
-  fprintf(stdout, "conWord = %ju(0x%jx)\n", int_zextend(vec->conWord, vec->size), int_zextend(vec->conWord, vec->size));
+  if(vec->size > WORD_BITS) {
+    intmax_t l; //Must be a signed integer
+    fprintf(stdout, "conWord = 0x");
+    for(l = VEC_LIMBS(vec->size)-1; l >= 0; l--)
+      fprintf(stdout, "%16.16jx", vec->conWords[l]);
+    fprintf(stdout, "\n");
+  } else {
+    fprintf(stdout, "conWord = %ju(0x%jx)\n", int_zextend(vec->conWord, vec->size), int_zextend(vec->conWord, vec->size));
+  }
   fprintf(stdout, "size    = %ju\n", vec->size);
   fprintf(stdout, "inuse   = %u\n", vec->inuse);
 }
@@ -388,6 +1008,16 @@ void vec_printArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_ele
 
 Vector *vec_joinArray(machine_state *ms, Vector **vec_array, uintmax_t num_arr_elements) {
   uintmax_t i, j, k;
+  
+  for(i = 0; i < num_arr_elements && vec_array[i]->term == 0; i++);
+  if(i < num_arr_elements) {
+    //Some element is a term, so is the result
+    uintmax_t t = vec_term_of(ms, vec_array[0]);
+    for(i = 1; i < num_arr_elements; i++)
+      t = vec_term_node(ms, VEC_TERM_CAT, (i+1)*vec_array[0]->size, vec_term_of(ms, vec_array[i]), t, 0);
+    return vec_term_get(ms, t);
+  }
+  
   Vector *ret = vec_get(ms, num_arr_elements*vec_array[0]->size); //All vectors in an array are assumed to be the same size.
   
   j = 0;
@@ -410,11 +1040,19 @@ Vector **vec_splitIntoNewArray(machine_state *ms, Vector *vec, uintmax_t num_arr
   assert(num_arr_elements > 0);
   assert(vec->size % num_arr_elements == 0);
   Vector **ret_array = vec_getArray(ms, num_arr_elements, vec->size / num_arr_elements);
+  if(vec->term != 0) {
+    vec_splitIntoArray(ms, vec, ret_array, num_arr_elements);
+    return ret_array;
+  }
   if(!vec->isSymbolic)
     vec_calc_sym(ms, vec);
   
   j = 0;
   for(i = 0; i < num_arr_elements; i++) {
+    if(vec_view(ms, ret_array[i], vec, j)) {
+      j += ret_array[i]->size;
+      continue;
+    }
     for(k = 0; k < ret_array[i]->size; k++) {
       ret_array[i]->symWord[k] = vec->symWord[j++];
     }
@@ -430,11 +1068,22 @@ void vec_splitIntoArray(machine_state *ms, Vector *vec, Vector **vec_array, uint
   uintmax_t i, j, k;
   assert(num_arr_elements > 0);
   assert(vec->size % num_arr_elements == 0);
+  if(vec->term != 0) {
+    //Each element is a slice of the term
+    for(i = 0, j = 0; i < num_arr_elements; j += vec_array[i]->size, i++)
+      vec_term_set(ms, vec_array[i], vec_term_node(ms, VEC_TERM_EXTRACT, vec_array[i]->size, vec->term, 0, j));
+    return;
+  }
   if(!vec->isSymbolic)
     vec_calc_sym(ms, vec);
   
   j = 0;
   for(i = 0; i < num_arr_elements; i++) {
+    if(vec_view(ms, vec_array[i], vec, j)) {
+      j += vec_array[i]->size;
+      continue;
+    }
+    vec_unshare(ms, vec_array[i]);
     for(k = 0; k < vec_array[i]->size; k++) {
       vec_array[i]->symWord[k] = vec->symWord[j++];
     }
@@ -454,11 +1103,64 @@ uintmax_t int_zextend(uintmax_t x, uintmax_t x_size) {
   return x;
 }
 
+//Index of the lowest set bit of 'x' (x != 0)
+uintmax_t int_lsb_index(uintmax_t x) {
+  uintmax_t i = 0;
+  assert(x != 0);
+  while(((x >> i) & 1) == 0) i++;
+  return i;
+}
+
+//Index of the highest set bit of 'x' (x != 0)
+uintmax_t int_msb_index(uintmax_t x) {
+  uintmax_t i = WORD_BITS-1;
+  assert(x != 0);
+  while(((x >> i) & 1) == 0) i--;
+  return i;
+}
+
+//The WORD_BITS bits of 'x' in reverse order
+uintmax_t int_reverse(uintmax_t x) {
+  uintmax_t s = WORD_BITS;
+  uintmax_t mask = ~0;
+  while ((s >>= 1) > 0) {
+    mask ^= (mask << s);
+    x = ((x >> s) & mask) | ((x << s) & ~mask);
+  }
+  return x;
+}
+
+//Known bits of a vector of at most WORD_BITS bits. Bit i of *mask is set
+//when bit i of 'vec' is a constant, whose value is then bit i of *value.
+//Computed from the literals, since every kernel writes .symWord directly.
+void vec_known_bits(Vector *vec, uintmax_t *mask, uintmax_t *value) {
+  assert(vec->size <= WORD_BITS);
+  if(!vec->isSymbolic) {
+    *mask = int_zextend(~((uintmax_t)0), vec->size);
+    *value = int_zextend(vec->conWord, vec->size);
+    return;
+  }
+  if(vec->term != 0) {
+    *mask = 0; //Not bit-blasted, so nothing is known
+    *value = 0;
+    return;
+  }
+  lits_pack(vec->symWord, vec->size, mask, value);
+}
+
 //BV-ZeroExtend
 Vector *vec_zextend(machine_state *ms, Vector *x, uintmax_t result_size) {
   uintmax_t i;
   assert(result_size >= x->size);
   assert(x->size > 0);
+  
+  if(x->term != 0 && result_size - x->size <= WORD_BITS) {
+    if(result_size == x->size) return vec_dup(ms, x);
+    uintmax_t zeros = vec_term_node(ms, VEC_TERM_CONST, result_size - x->size, 0, 0, 0);
+    return vec_term_get(ms, vec_term_node(ms, VEC_TERM_CAT, result_size, zeros, x->term, 0));
+  }
+  vec_force(ms, x);
+  
   Vector *ret = vec_get(ms, result_size);
   
   //Concrete case
@@ -469,7 +1171,11 @@ Vector *vec_zextend(machine_state *ms, Vector *x, uintmax_t result_size) {
       ret->isSymbolic = 0;
       return ret;
     }
-    vec_calc_sym(ms, x);
+    //Wide concrete case
+    vec_con_clear(ret);
+    vec_con_copybits(ret, 0, x, 0, x->size);
+    ret->isSymbolic = 0;
+    return ret;
   }
   
   //Symbolic case
@@ -502,6 +1208,7 @@ Vector *vec_sextend(machine_state *ms, Vector *x, uintmax_t result_size) {
   uintmax_t i;
   assert(result_size >= x->size);
   assert(x->size > 0);
+  vec_force(ms, x);
   Vector *ret = vec_get(ms, result_size);
   
   //Concrete case
@@ -511,7 +1218,12 @@ Vector *vec_sextend(machine_state *ms, Vector *x, uintmax_t result_size) {
       ret->isSymbolic = 0;
       return ret;
     }
-    vec_calc_sym(ms, x);
+    //Wide concrete case
+    vec_con_clear(ret);
+    vec_con_copybits(ret, 0, x, 0, x->size);
+    vec_con_fillbits(ret, x->size, result_size - x->size, vec_con_getbits(x, x->size-1, 1));
+    ret->isSymbolic = 0;
+    return ret;
   }
   
   //Symbolic case
@@ -529,6 +1241,9 @@ Vector *vec_sextend(machine_state *ms, Vector *x, uintmax_t result_size) {
 Vector *vec_cat(machine_state *ms, Vector *x, Vector *y) {
   uintmax_t i;
   
+  if(x->term != 0 || y->term != 0)
+    return vec_term_get(ms, vec_term_node(ms, VEC_TERM_CAT, x->size + y->size, vec_term_of(ms, x), vec_term_of(ms, y), 0));
+  
   Vector *ret = vec_get(ms, x->size + y->size);
   
   if(!x->isSymbolic) {
@@ -540,8 +1255,12 @@ Vector *vec_cat(machine_state *ms, Vector *x, Vector *y) {
 	ret->isSymbolic = 0;
 	return ret;
       } else {
-	vec_calc_sym(ms, x);
-	vec_calc_sym(ms, y);
+	//Wide concrete case
+	vec_con_clear(ret);
+	vec_con_copybits(ret, 0, y, 0, y->size);
+	vec_con_copybits(ret, y->size, x, 0, x->size);
+	ret->isSymbolic = 0;
+	return ret;
       }
     } else {
       vec_calc_sym(ms, x);
@@ -566,24 +1285,31 @@ Vector *vec_trunc(machine_state *ms, Vector *x, uintmax_t amount) {
   assert(x->size >= amount);
   uintmax_t i;
 
+  if(x->term != 0)
+    return vec_term_get(ms, vec_term_node(ms, VEC_TERM_EXTRACT, amount, x->term, 0, 0));
+  
   Vector *ret = vec_get(ms, amount);
 
   if(!x->isSymbolic) {
-    uintmax_t mask = ((uintmax_t) ~0)>>(WORD_BITS - amount);
-    ret->conWord = x->conWord & mask;
+    if(x->size > WORD_BITS) {
+      vec_con_clear(ret);
+      vec_con_copybits(ret, 0, x, 0, amount);
+    } else {
+      uintmax_t mask = ((uintmax_t) ~0)>>(WORD_BITS - amount);
+      ret->conWord = x->conWord & mask;
+    }
     ret->isSymbolic = 0;
     return ret;
   }
   
-  uint8_t isSymbolic = 0;
+  if(vec_view(ms, ret, x, 0))
+    return ret;
+  
   for(i = 0; i < amount; i++) {
     ret->symWord[i] = x->symWord[i];
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -593,28 +1319,35 @@ Vector *vec_trunc(machine_state *ms, Vector *x, uintmax_t amount) {
 //BV-Extract
 Vector *vec_extract(machine_state *ms, Vector *x, uintmax_t start, uintmax_t amount) {
   assert(start < x->size);
-  assert(amount < x->size);
-  assert(start + amount < x->size);
+  assert(amount <= x->size);
+  assert(start + amount <= x->size);
   uintmax_t i;
 
+  if(x->term != 0)
+    return vec_term_get(ms, vec_term_node(ms, VEC_TERM_EXTRACT, amount, x->term, 0, start));
+  
   Vector *ret = vec_get(ms, amount);
   
   if(!x->isSymbolic) {
-    uintmax_t mask = ((uintmax_t)~0)>>(WORD_BITS - amount);
-    ret->conWord = (x->conWord>>start) & mask;
+    if(x->size > WORD_BITS) {
+      vec_con_clear(ret);
+      vec_con_copybits(ret, 0, x, start, amount);
+    } else {
+      uintmax_t mask = ((uintmax_t)~0)>>(WORD_BITS - amount);
+      ret->conWord = (x->conWord>>start) & mask;
+    }
     ret->isSymbolic = 0;
     return ret;
   }
   
-  uint8_t isSymbolic = 0;
+  if(vec_view(ms, ret, x, start))
+    return ret;
+  
   for(i = 0; i < amount; i++) {
     ret->symWord[i] = x->symWord[start+i];
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -626,12 +1359,18 @@ Vector *vec_and(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_AND, x, y);
+  if(ret != NULL) return ret;
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
-      //Concrete case
-      ret->conWord = x->conWord & y->conWord;
+      //Concrete case, one word at a time when wider than WORD_BITS
+      for(i = 0; i < VEC_LIMBS(x->size); i++)
+	ret->conWords[i] = x->conWords[i] & y->conWords[i];
       ret->isSymbolic = 0;
       return ret;
     } else {
@@ -641,16 +1380,24 @@ Vector *vec_and(machine_state *ms, Vector *x, Vector *y) {
     vec_calc_sym(ms, y);
   }
   
+  //Known 0s decides a bit on its own
+  if(x->size <= WORD_BITS) {
+    uintmax_t xm, xv, ym, yv;
+    vec_known_bits(x, &xm, &xv);
+    vec_known_bits(y, &ym, &yv);
+    if(((xm & ym) | (xm & ~xv) | (ym & ~yv)) == int_zextend(~((uintmax_t)0), x->size)) {
+      ret->conWord = xv & yv;
+      ret->isSymbolic = 0;
+      return ret;
+    }
+  }
+  
   //Symbolic case
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
   for(i = 0; i < x->size; i++) {
     ret->symWord[i] = Gia_ManHashAnd(ms->ntk, x->symWord[i], y->symWord[i]);
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -662,12 +1409,18 @@ Vector *vec_or(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_OR, x, y);
+  if(ret != NULL) return ret;
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
-      //Concrete case
-      ret->conWord = x->conWord | y->conWord;
+      //Concrete case, one word at a time when wider than WORD_BITS
+      for(i = 0; i < VEC_LIMBS(x->size); i++)
+	ret->conWords[i] = x->conWords[i] | y->conWords[i];
       ret->isSymbolic = 0;
       return ret;
     } else {
@@ -677,16 +1430,24 @@ Vector *vec_or(machine_state *ms, Vector *x, Vector *y) {
     vec_calc_sym(ms, y);
   }
   
+  //Known 1s decides a bit on its own
+  if(x->size <= WORD_BITS) {
+    uintmax_t xm, xv, ym, yv;
+    vec_known_bits(x, &xm, &xv);
+    vec_known_bits(y, &ym, &yv);
+    if(((xm & ym) | (xm & xv) | (ym & yv)) == int_zextend(~((uintmax_t)0), x->size)) {
+      ret->conWord = xv | yv;
+      ret->isSymbolic = 0;
+      return ret;
+    }
+  }
+  
   //Symbolic case
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
   for(i = 0; i < x->size; i++) {
     ret->symWord[i] = Gia_ManHashOr(ms->ntk, x->symWord[i], y->symWord[i]);
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -698,12 +1459,18 @@ Vector *vec_xor(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_XOR, x, y);
+  if(ret != NULL) return ret;
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
-      //Concrete case
-      ret->conWord = x->conWord ^ y->conWord;
+      //Concrete case, one word at a time when wider than WORD_BITS
+      for(i = 0; i < VEC_LIMBS(x->size); i++)
+	ret->conWords[i] = x->conWords[i] ^ y->conWords[i];
       ret->isSymbolic = 0;
       return ret;
     } else {
@@ -714,15 +1481,11 @@ Vector *vec_xor(machine_state *ms, Vector *x, Vector *y) {
   }
   
   //Symbolic case
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
   for(i = 0; i < x->size; i++) {
     ret->symWord[i] = Gia_ManHashXor(ms->ntk, x->symWord[i], y->symWord[i]);
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -732,29 +1495,23 @@ Vector *vec_xor(machine_state *ms, Vector *x, Vector *y) {
 //BV-Equality Test - returns 0 if x and y are not equivalent, 1 if they are equivalent, and 2 if unknown
 uint8_t vec_sym_equal(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
-  uintmax_t i;
+  if(vec_same(ms, x, y) && vec_rule_fire(ms, VEC_RULE_SELF)) return 1;
+  vec_force(ms, x);
+  vec_force(ms, y);
   
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
       //Concrete case
-      uintmax_t x_ze = int_zextend(x->conWord, x->size);
-      uintmax_t y_ze = int_zextend(y->conWord, y->size);
-      if(x_ze == y_ze) return 1;
-      else return 0;
+      return vec_con_equal(x, y);
     } else {
       vec_calc_sym(ms, x);      
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
   }
-  uint8_t are_equal = 1;
-  for(i = 0; i < x->size; i++) {
-    if(Abc_LitNot(x->symWord[i]) == y->symWord[i]) return 0;
-    if(x->symWord[i] == y->symWord[i]) continue;
-    else are_equal = 2; //not concrete
-  }
-  
-  return are_equal;	  
+  if(lits_any_complement(x->symWord, y->symWord, x->size)) return 0;
+  if(lits_equal(x->symWord, y->symWord, x->size)) return 1;
+  return 2; //not concrete
 }
 
 //BV-Equality Test - returns a single AIG node
@@ -809,15 +1566,73 @@ Gia_Lit_t vec_equal_SAT(machine_state *ms, Vector *x, Vector *y, uint8_t call_SA
   return ret;
 }
 
-//BV-Negate / two's complement
-Vector *vec_negate(machine_state *ms, Vector *x) {
+//Equality of two literals, as vec_equal_SAT
+Gia_Lit_t lit_equal_SAT(machine_state *ms, Gia_Lit_t x, Gia_Lit_t y, uint8_t call_SAT_solver) {
+  Gia_Lit_t ret = Abc_LitNot(Gia_ManHashXor(ms->ntk, x, y));
+
+  if(!Gia_ManIsConstLit(ret)) {
+    if(call_SAT_solver) {
+      if(is_node_constant(ms, ret, 0)) {
+	ret = Gia_ManConst0Lit();
+      } else if(is_node_constant(ms, ret, 1)) {
+	ret = Gia_ManConst1Lit();
+      }
+    }
+  }
+
+  return ret;
+}
+
+//Index of the first pair x[i], y[i] the SAT solver cannot prove equal, or
+//n if all are equal
+uintmax_t vec_find_unequal(machine_state *ms, Vector **x, Vector **y, uintmax_t n) {
   uintmax_t i;
-  
+  for(i = 0; i < n; i++)
+    if(vec_equal_SAT(ms, x[i], y[i], 1) != Gia_ManConst1Lit())
+      break;
+  return i;
+}
+
+uintmax_t lit_find_unequal(machine_state *ms, Gia_Lit_t *x, Gia_Lit_t *y, uintmax_t n) {
+  uintmax_t i;
+  for(i = 0; i < n; i++)
+    if(lit_equal_SAT(ms, x[i], y[i], 1) != Gia_ManConst1Lit())
+      break;
+  return i;
+}
+
+//AIG level of a literal, and the deepest of a vector's literals. Levels
+//are only current after Gia_ManLevelNum
+int lit_depth(machine_state *ms, Gia_Lit_t lit) {
+  return Gia_ObjLevelId(ms->ntk, Abc_Lit2Var(lit));
+}
+
+int vec_depth(machine_state *ms, Vector *x) {
+  uintmax_t i;
+  int depth = 0;
+  if(!x->isSymbolic) return 0;
+  for(i = 0; i < x->size; i++)
+    if(lit_depth(ms, x->symWord[i]) > depth) depth = lit_depth(ms, x->symWord[i]);
+  return depth;
+}
+
+//BV-Negate / two's complement
+Vector *vec_negate(machine_state *ms, Vector *x) {
+  uintmax_t i;
+  vec_force(ms, x);
+  
   Vector *ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     //Concrete case
-    ret->conWord = -(int_sextend(x->conWord, x->size, WORD_BITS));
+    if(x->size > WORD_BITS) {
+      uintmax_t carry = 1;
+      for(i = 0; i < VEC_LIMBS(x->size); i++) {
+	ret->conWords[i] = ~x->conWords[i] + carry;
+	carry = carry && (ret->conWords[i] == 0);
+      }
+      vec_con_trim(ret);
+    } else ret->conWord = -(int_sextend(x->conWord, x->size, WORD_BITS));
     ret->isSymbolic = 0;
     return ret;
   }
@@ -837,12 +1652,17 @@ Vector *vec_negate(machine_state *ms, Vector *x) {
 //BV-Invert
 Vector *vec_invert(machine_state *ms, Vector *x) {
   uintmax_t i;
+  vec_force(ms, x);
   
   Vector *ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     //Concrete case
-    ret->conWord = int_zextend(~x->conWord, x->size);
+    if(x->size > WORD_BITS) {
+      for(i = 0; i < VEC_LIMBS(x->size); i++)
+	ret->conWords[i] = ~x->conWords[i];
+      vec_con_trim(ret);
+    } else ret->conWord = int_zextend(~x->conWord, x->size);
     ret->isSymbolic = 0;
     return ret;
   }
@@ -870,10 +1690,22 @@ Vector *vec_ite(machine_state *ms, Gia_Lit_t c, Vector *x, Vector *y) {
     return ret;
   }
   
+  if(vec_same(ms, x, y) && vec_rule_fire(ms, VEC_RULE_SELF)) {
+    vec_copy(ms, ret, x);
+    return ret;
+  }
+  
+  if(vec_term_wanted(ms, x, y)) {
+    vec_term_set(ms, ret, vec_term_node(ms, VEC_TERM_ITE, x->size, vec_term_of(ms, x), vec_term_of(ms, y), c));
+    return ret;
+  }
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
   //Concrete vector case
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
-      if(x->conWord == y->conWord) {
+      if(vec_con_equal(x, y)) {
 	vec_copy(ms, ret, x);
 	return ret;
       }
@@ -897,10 +1729,11 @@ Vector *vec_ite(machine_state *ms, Gia_Lit_t c, Vector *x, Vector *y) {
 //BV-AbsoluteValue
 Vector *vec_abs(machine_state *ms, Vector *x) {
   Vector *ret;
+  vec_force(ms, x);
   
   if(!x->isSymbolic) {
     //Concrete case
-    uint8_t sign = (x->conWord >> (x->size-1))&1;
+    uint8_t sign = vec_con_getbits(x, x->size-1, 1);
     if(sign == 0) {
       ret = vec_get(ms, x->size);
       vec_copy(ms, ret, x);
@@ -924,9 +1757,12 @@ Vector *vec_abs(machine_state *ms, Vector *x) {
 Gia_Lit_t vec_greaterthan(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   intmax_t i; //Must be a signed integer
+  if(vec_same(ms, x, y) && vec_rule_fire(ms, VEC_RULE_SELF)) return Gia_ManConst0Lit();
+  vec_force(ms, x);
+  vec_force(ms, y);
   
   if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
+    if(!y->isSymbolic && x->size <= WORD_BITS) {
       //Concrete case
       uintmax_t x_ze = int_zextend(x->conWord, x->size);
       uintmax_t y_ze = int_zextend(y->conWord, y->size);
@@ -934,16 +1770,31 @@ Gia_Lit_t vec_greaterthan(machine_state *ms, Vector *x, Vector *y) {
       else return Gia_ManConst0Lit();
     } else {
       vec_calc_sym(ms, x);
+      if(!y->isSymbolic) vec_calc_sym(ms, y); //Wider than WORD_BITS
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
   }
   
+  //Skip the high bits known to be equal; if the first bit that is not
+  //known to be equal is known on both sides, it decides the comparison.
+  intmax_t top = x->size-1;
+  if(x->size <= WORD_BITS) {
+    uintmax_t xm, xv, ym, yv;
+    vec_known_bits(x, &xm, &xv);
+    vec_known_bits(y, &ym, &yv);
+    uintmax_t undecided = int_zextend(~(xm & ym & ~(xv ^ yv)), x->size);
+    if(undecided == 0) return Gia_ManConst0Lit();
+    top = int_msb_index(undecided);
+    if(((xm & ym) >> top) & 1)
+      return ((xv >> top) & 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+  }
+  
   //Symbolic case
   Gia_Lit_t known = Gia_ManConst0Lit();
   Gia_Lit_t ret = Gia_ManConst0Lit();
   
-  for(i = (x->size-1); i >= 0; i--) {
+  for(i = top; i >= 0; i--) {
     ret = Gia_ManHashMux(ms->ntk, known, ret,
 		     Gia_ManHashAnd(ms->ntk, x->symWord[i], Abc_LitNot(y->symWord[i])));
     known = Gia_ManHashOr(ms->ntk, known, Gia_ManHashXor(ms->ntk, x->symWord[i], y->symWord[i]));
@@ -957,9 +1808,12 @@ Gia_Lit_t vec_greaterthan(machine_state *ms, Vector *x, Vector *y) {
 //BV-SignedGreaterThan
 Gia_Lit_t vec_signed_greaterthan(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
+  if(vec_same(ms, x, y) && vec_rule_fire(ms, VEC_RULE_SELF)) return Gia_ManConst0Lit();
+  vec_force(ms, x);
+  vec_force(ms, y);
   
   if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
+    if(!y->isSymbolic && x->size <= WORD_BITS) {
       //Concrete case
       intmax_t x_ze = (intmax_t) int_sextend(x->conWord, x->size, WORD_BITS);
       intmax_t y_ze = (intmax_t) int_sextend(y->conWord, y->size, WORD_BITS);
@@ -967,6 +1821,7 @@ Gia_Lit_t vec_signed_greaterthan(machine_state *ms, Vector *x, Vector *y) {
       else return Gia_ManConst0Lit();
     } else {
       vec_calc_sym(ms, x);
+      if(!y->isSymbolic) vec_calc_sym(ms, y); //Wider than WORD_BITS
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
@@ -1041,18 +1896,76 @@ Gia_Lit_t vec_signed_lessthan(machine_state *ms, Vector *x, Vector *y) {
   return vec_signed_greaterthan(ms, y, x);
 }
 
+//Logarithmic barrel shifter for a symbolic amount; x must have valid
+//literals. For shifts, only the low ceil(log2(width)) bits of the amount
+//drive mux stages and all higher amount bits are ORed into one overflow
+//literal that fills the whole result. For rotates, amount bit i is a
+//stage rotating by 2^i mod width, so no stage is built for the high bits
+//of a power-of-two width and no divider for any other width. 'left' picks
+//the direction and 'fill' is the literal shifted in.
+Vector *vec_barrel_shift(machine_state *ms, Vector *x, Vector *amount, uint8_t left, uint8_t rotate, Gia_Lit_t fill) {
+  uintmax_t i, j, n = x->size;
+  uintmax_t stages = (n > 1) ? int_msb_index(n-1) + 1 : 0;
+  vec_force(ms, x);
+  vec_force(ms, amount);
+  
+  if(!amount->isSymbolic) vec_calc_sym(ms, amount);
+  
+  Vector *cur = vec_get(ms, n);
+  Vector *next = vec_get(ms, n);
+  for(j = 0; j < n; j++)
+    cur->symWord[j] = x->symWord[j];
+  
+  //step is 2^i mod n, which is 2^i itself for the shift stages
+  uintmax_t step = 1 % n;
+  for(i = 0; i < amount->size && (rotate || i < stages); i++, step = (2*step) % n) {
+    Gia_Lit_t sel = amount->symWord[i];
+    if(step == 0 || Gia_ManIsConst0Lit(sel)) continue;
+    for(j = 0; j < n; j++) {
+      Gia_Lit_t moved;
+      if(left) moved = (j >= step) ? cur->symWord[j-step] : (rotate ? cur->symWord[j+n-step] : fill);
+      else moved = (j+step < n) ? cur->symWord[j+step] : (rotate ? cur->symWord[j+step-n] : fill);
+      next->symWord[j] = Gia_ManHashMux(ms->ntk, sel, moved, cur->symWord[j]);
+    }
+    Vector *tmp = cur; cur = next; next = tmp;
+  }
+  
+  if(!rotate) {
+    Gia_Lit_t overflow = Gia_ManConst0Lit();
+    for(i = stages; i < amount->size; i++)
+      overflow = Gia_ManHashOr(ms->ntk, overflow, amount->symWord[i]);
+    if(!Gia_ManIsConst0Lit(overflow))
+      for(j = 0; j < n; j++)
+	cur->symWord[j] = Gia_ManHashMux(ms->ntk, overflow, fill, cur->symWord[j]);
+  }
+  
+  vec_release(ms, next);
+  if(!vec_sym_to_con_attempt(ms, cur))
+    cur->isSymbolic = 1;
+  return cur;
+}
+
 //BV-ShiftRight
 Vector *vec_shiftright(machine_state *ms, Vector *x, Vector *amount) {
   uintmax_t i, j;
+  vec_force(ms, x);
+  vec_force(ms, amount);
   
   Vector *ret = vec_get(ms, x->size);
   
   if(!amount->isSymbolic) {
     if(!x->isSymbolic) {
       //Concrete case
+      uintmax_t amount_ze = vec_con_saturate(amount);
+      if(x->size > WORD_BITS) {
+	vec_con_clear(ret);
+	if(amount_ze < x->size)
+	  vec_con_copybits(ret, 0, x, amount_ze, x->size - amount_ze);
+	ret->isSymbolic = 0;
+	return ret;
+      }
       vec_copy(ms, ret, x);
       uintmax_t x_ze = int_zextend(x->conWord, x->size);
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
       if(amount_ze >= x->size) {
 	ret->conWord = 0;
       } else {
@@ -1061,21 +1974,17 @@ Vector *vec_shiftright(machine_state *ms, Vector *x, Vector *amount) {
       return ret;         
     } else {
       //Case with concrete amount, but symbolic value
-      uint8_t isSymbolic = (ret->size > WORD_BITS);
       j = 0;
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
+      uintmax_t amount_ze = vec_con_saturate(amount);
       for(i = amount_ze; i < x->size; i++) {
 	ret->symWord[j] = x->symWord[i];
-	if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[j])) {
-	  isSymbolic = 1;
-	}
 	j++;
       }
       for( ;j < x->size; j++) {
 	ret->symWord[j] = Gia_ManConst0Lit();
       }
       
-      if(!isSymbolic) 
+      if(lits_all_const(ret->symWord, ret->size))
 	vec_sym_to_con(ms, ret);
       else ret->isSymbolic = 1;
       
@@ -1085,37 +1994,45 @@ Vector *vec_shiftright(machine_state *ms, Vector *x, Vector *amount) {
     vec_calc_sym(ms, x);
   }
   
-  //Symbolic case
-  vec_copy(ms, ret, x);
-  uint8_t short_circuit = 0;
-  for(i = 0; i < amount->size; i++) {
-    for(j = 0; j < x->size; j++) {
-      if(short_circuit || (j + (1<<i) >= x->size)) {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], Gia_ManConst0Lit(), ret->symWord[j]);
-	if((1<<i) > x->size) short_circuit = 1;
-      } else {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], ret->symWord[j+(1<<i)], ret->symWord[j]);
-      }
+  //Amount known to be at least the width of x
+  if(amount->size <= WORD_BITS) {
+    uintmax_t am, av;
+    vec_known_bits(amount, &am, &av);
+    if(av >= x->size) {
+      vec_setValue(ms, ret, 0);
+      return ret;
     }
   }
   
-  ret->isSymbolic = 1;
-  
-  return ret;
+  //Symbolic case
+  vec_release(ms, ret);
+  return vec_barrel_shift(ms, x, amount, 0, 0, Gia_ManConst0Lit());
 }
 
 //BV-SignedShiftRight
 Vector *vec_signedshiftright(machine_state *ms, Vector *x, Vector *amount) {
   uintmax_t i, j;
+  vec_force(ms, x);
+  vec_force(ms, amount);
   
   Vector *ret = vec_get(ms, x->size);
   
   if(!amount->isSymbolic) {
     if(!x->isSymbolic) {
       //Concrete case
+      uintmax_t amount_ze = vec_con_saturate(amount);
+      if(x->size > WORD_BITS) {
+	uint8_t sign = vec_con_getbits(x, x->size-1, 1);
+	vec_con_clear(ret);
+	if(amount_ze < x->size) {
+	  vec_con_copybits(ret, 0, x, amount_ze, x->size - amount_ze);
+	  vec_con_fillbits(ret, x->size - amount_ze, amount_ze, sign);
+	} else vec_con_fillbits(ret, 0, x->size, sign);
+	ret->isSymbolic = 0;
+	return ret;
+      }
       vec_copy(ms, ret, x);
       intmax_t x_se = (intmax_t) int_sextend(x->conWord, x->size, WORD_BITS);
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
       if(amount_ze >= x->size) {
 	ret->conWord = (uintmax_t) (x_se >> (WORD_BITS-1));
       } else {
@@ -1124,21 +2041,17 @@ Vector *vec_signedshiftright(machine_state *ms, Vector *x, Vector *amount) {
       return ret;         
     } else {
       //Case with concrete amount, but symbolic value
-      uint8_t isSymbolic = (ret->size > WORD_BITS);
       j = 0;
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
+      uintmax_t amount_ze = vec_con_saturate(amount);
       for(i = amount_ze; i < x->size; i++) {
 	ret->symWord[j] = x->symWord[i];
-	if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[j])) {
-	  isSymbolic = 1;
-	}
 	j++;
       }
       for( ;j < x->size; j++) {
 	ret->symWord[j] = x->symWord[x->size-1];
       }
       
-      if(!isSymbolic) 
+      if(lits_all_const(ret->symWord, ret->size))
 	vec_sym_to_con(ms, ret);
       else ret->isSymbolic = 1;
       
@@ -1148,37 +2061,45 @@ Vector *vec_signedshiftright(machine_state *ms, Vector *x, Vector *amount) {
     vec_calc_sym(ms, x);
   }
   
-  //Symbolic case
-  vec_copy(ms, ret, x);
-  uint8_t short_circuit = 0;
-  for(i = 0; i < amount->size; i++) {
-    for(j = 0; j < x->size-1; j++) {
-      if(short_circuit || (j + (1<<i) >= x->size)) {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], x->symWord[x->size-1], ret->symWord[j]);
-	if((1<<i) > x->size) short_circuit = 1;
-      } else {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], ret->symWord[j+(1<<i)], ret->symWord[j]);
-      }
+  //Amount known to be at least the width of x
+  if(amount->size <= WORD_BITS) {
+    uintmax_t am, av;
+    vec_known_bits(amount, &am, &av);
+    if(av >= x->size) {
+      for(i = 0; i < x->size; i++)
+	ret->symWord[i] = x->symWord[x->size-1];
+      if(!vec_sym_to_con_attempt(ms, ret))
+	ret->isSymbolic = 1;
+      return ret;
     }
   }
   
-  ret->isSymbolic = 1;
-  
-  return ret;
+  //Symbolic case
+  vec_release(ms, ret);
+  return vec_barrel_shift(ms, x, amount, 0, 0, x->symWord[x->size-1]);
 }
 
 //BV-ShiftLeft
 Vector *vec_shiftleft(machine_state *ms, Vector *x, Vector *amount) {
   uintmax_t i, j;
+  vec_force(ms, x);
+  vec_force(ms, amount);
   
   Vector *ret = vec_get(ms, x->size);
   
   if(!amount->isSymbolic) {
     if(!x->isSymbolic) {
       //Concrete case
+      uintmax_t amount_ze = vec_con_saturate(amount);
+      if(x->size > WORD_BITS) {
+	vec_con_clear(ret);
+	if(amount_ze < x->size)
+	  vec_con_copybits(ret, amount_ze, x, 0, x->size - amount_ze);
+	ret->isSymbolic = 0;
+	return ret;
+      }
       vec_copy(ms, ret, x);
       uintmax_t x_ze = int_zextend(x->conWord, x->size);
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
       if(amount_ze >= x->size) {
 	ret->conWord = 0;
       } else {
@@ -1187,21 +2108,17 @@ Vector *vec_shiftleft(machine_state *ms, Vector *x, Vector *amount) {
       return ret;         
     } else {
       //Case with concrete amount, but symbolic value
-      uint8_t isSymbolic = (ret->size > WORD_BITS);
       j = 0;
-      uintmax_t amount_ze = int_zextend(amount->conWord, amount->size);
+      uintmax_t amount_ze = vec_con_saturate(amount);
       for(j = 0; (j < amount_ze) && (j < x->size); j++) {
 	ret->symWord[j] = Gia_ManConst0Lit();
       }
       for(i = 0; j < x->size; i++) {
 	ret->symWord[j] = x->symWord[i];
-	if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[j])) {
-	  isSymbolic = 1;
-	}
 	j++;            
       }
       
-      if(!isSymbolic)
+      if(lits_all_const(ret->symWord, ret->size))
 	vec_sym_to_con(ms, ret);
       else ret->isSymbolic = 1;
       
@@ -1211,28 +2128,26 @@ Vector *vec_shiftleft(machine_state *ms, Vector *x, Vector *amount) {
     vec_calc_sym(ms, x);
   }
   
-  //Symbolic case
-  vec_copy(ms, ret, x);
-  uint8_t short_circuit = 0;
-  for(i = 0; i < amount->size; i++) {
-    for(j = (x->size-1); j != ~0; j--) {
-      if(short_circuit || ((1<<i) > j)) {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], Gia_ManConst0Lit(), ret->symWord[j]);
-	if((1<<i) > x->size) short_circuit = 1;
-      } else {
-	ret->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i], ret->symWord[j-(1<<i)], ret->symWord[j]);
-      }
+  //Amount known to be at least the width of x
+  if(amount->size <= WORD_BITS) {
+    uintmax_t am, av;
+    vec_known_bits(amount, &am, &av);
+    if(av >= x->size) {
+      vec_setValue(ms, ret, 0);
+      return ret;
     }
   }
   
-  ret->isSymbolic = 1;
-  
-  return ret;
+  //Symbolic case
+  vec_release(ms, ret);
+  return vec_barrel_shift(ms, x, amount, 1, 0, Gia_ManConst0Lit());
 }
 
 //BV-RotateRight
 Vector *vec_rotateright(machine_state *ms, Vector *x, Vector *amount) {
   uintmax_t i, j;
+  vec_force(ms, x);
+  vec_force(ms, amount);
   
   //large word bit-vector rotates is currently not available.
   assert(x->size <= WORD_BITS);
@@ -1240,7 +2155,7 @@ Vector *vec_rotateright(machine_state *ms, Vector *x, Vector *amount) {
   Vector *ret = vec_get(ms, x->size);
   
   if(!amount->isSymbolic) {
-    uintmax_t amount_mod = amount->conWord % x->size;
+    uintmax_t amount_mod = vec_con_mod(amount, x->size);
     if(!x->isSymbolic) {
       //Concrete case
       vec_copy(ms, ret, x);
@@ -1269,25 +2184,15 @@ Vector *vec_rotateright(machine_state *ms, Vector *x, Vector *amount) {
   }
   
   //Symbolic case
-  Vector *tmp_vec = vec_get(ms, x->size);
-  vec_copy(ms, ret, x);
-  for(i = 0; i < amount->size; i++) {
-    for(j = 0; j < x->size; j++) {
-      tmp_vec->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i],
-				       ret->symWord[(j+(1<<i))%((uintmax_t)x->size)],
-				       ret->symWord[j]);
-    }
-    vec_copy(ms, ret, tmp_vec);
-  }
-  vec_release(ms, tmp_vec);
-  ret->isSymbolic = 1;
-  
-  return ret;
+  vec_release(ms, ret);
+  return vec_barrel_shift(ms, x, amount, 0, 1, Gia_ManConst0Lit());
 }
 
 //BV-RotateLeft
 Vector *vec_rotateleft(machine_state *ms, Vector *x, Vector *amount) {
   uintmax_t i, j;
+  vec_force(ms, x);
+  vec_force(ms, amount);
   
   //large word bit-vector rotates is currently not available.
   assert(x->size <= WORD_BITS);
@@ -1295,7 +2200,7 @@ Vector *vec_rotateleft(machine_state *ms, Vector *x, Vector *amount) {
   Vector *ret = vec_get(ms, x->size);
   
   if(!amount->isSymbolic) {
-    uintmax_t amount_mod = amount->conWord % x->size;
+    uintmax_t amount_mod = vec_con_mod(amount, x->size);
     if(!x->isSymbolic) {
       //Concrete case
       vec_copy(ms, ret, x);
@@ -1312,7 +2217,7 @@ Vector *vec_rotateleft(machine_state *ms, Vector *x, Vector *amount) {
 	ret->symWord[j] = x->symWord[i];
 	j++;            
       }
-      for(i = amount_mod; j < x->size; i++) {
+      for(i = 0; j < x->size; i++) {
 	ret->symWord[j] = x->symWord[i];
 	j++;
       }
@@ -1324,47 +2229,40 @@ Vector *vec_rotateleft(machine_state *ms, Vector *x, Vector *amount) {
   }
   
   //Symbolic case
-  Vector *tmp_vec = vec_get(ms, x->size);
-  vec_copy(ms, ret, x);
-  for(i = 0; i < amount->size; i++) {
-    for(j = 0; j < x->size; j++) {
-      tmp_vec->symWord[j] = Gia_ManHashMux(ms->ntk, amount->symWord[i],
-				       ret->symWord[(((uintmax_t) x->size) - (1<<i) + j)%((uintmax_t) x->size)],
-				       ret->symWord[j]);
-    }
-    vec_copy(ms, ret, tmp_vec);
-  }
-  vec_release(ms, tmp_vec);
-  ret->isSymbolic = 1;
-  
-  return ret;
+  vec_release(ms, ret);
+  return vec_barrel_shift(ms, x, amount, 1, 1, Gia_ManConst0Lit());
 }
 
 //BV-SelectBits
 Vector *vec_selectBits(machine_state *ms, Vector *x, uint16_t num_bits, uint16_t bit_offset) {
   uint16_t i;
   assert((num_bits + bit_offset) <= x->size);
+  vec_force(ms, x);
   
   Vector *ret = vec_get(ms, num_bits);
   
   if(!x->isSymbolic) {
     //Concrete case
-    uintmax_t x_ze = int_zextend(x->conWord, x->size);
-    ret->conWord = x_ze >> bit_offset;
+    if(x->size > WORD_BITS) {
+      vec_con_clear(ret);
+      vec_con_copybits(ret, 0, x, bit_offset, num_bits);
+    } else {
+      uintmax_t x_ze = int_zextend(x->conWord, x->size);
+      ret->conWord = x_ze >> bit_offset;
+    }
     ret->isSymbolic = 0;
     return ret;      
   }
   
+  if(vec_view(ms, ret, x, bit_offset))
+    return ret;
+  
   //Symbolic case
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
   for(i = 0; i < num_bits; i++) {
     ret->symWord[i] = x->symWord[i + bit_offset];
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
@@ -1374,20 +2272,25 @@ Vector *vec_selectBits(machine_state *ms, Vector *x, uint16_t num_bits, uint16_t
 //BV-Reverse
 Vector *vec_reverse(machine_state *ms, Vector *x) {
   uintmax_t i;
+  vec_force(ms, x);
   
   Vector *ret = vec_get(ms, x->size);
   ret->isSymbolic = x->isSymbolic;
   
-  if(!x->isSymbolic) {
+  if(!x->isSymbolic && x->size > WORD_BITS) {
+    //Concrete case, a limb at a time from the top of ret down
+    uintmax_t chunk;
+    vec_con_clear(ret);
+    for(i = 0; i < x->size; i += chunk) {
+      chunk = ((x->size - i) < WORD_BITS) ? (x->size - i) : WORD_BITS;
+      vec_con_setbits(ret, x->size - i - chunk, chunk,
+		      int_reverse(vec_con_getbits(x, i, chunk)) >> (WORD_BITS - chunk));
+    }
+    ret->isSymbolic = 0;
+    return ret;
+  } else if(!x->isSymbolic) {
     //Concrete case
-    uintmax_t v = x->conWord;
-    uintmax_t s = sizeof(v) * BITS_IN_BYTE;
-    uintmax_t mask = ~0;
-    while ((s >>= 1) > 0) {
-      mask ^= (mask << s);
-      v = ((v >> s) & mask) | ((v << s) & ~mask);
-    }
-    ret->conWord = v>>(WORD_BITS - x->size);
+    ret->conWord = int_reverse(x->conWord)>>(WORD_BITS - x->size);
     ret->isSymbolic = 0;
     return ret; //SEAN!!! test this code
   }
@@ -1401,19 +2304,98 @@ Vector *vec_reverse(machine_state *ms, Vector *x) {
   return ret;
 }
 
+//Parallel-prefix adder over n bits: sum = x + (invert_y ? ~y : y) + carry.
+//Writes the n sum bits to 'sum' (unless NULL) and returns the carry out of
+//the top bit. The carries come from a Brent-Kung network over (generate,
+//propagate) pairs if ms->vec_adder asks for one, otherwise Kogge-Stone.
+Gia_Lit_t vec_prefix_add(machine_state *ms, Gia_Lit_t *sum, Gia_Lit_t *x, Gia_Lit_t *y, uintmax_t n, Gia_Lit_t carry, uint8_t invert_y) {
+  uintmax_t i, d;
+  assert(n > 0);
+  
+  Vector *half = vec_get(ms, n); //x^y per bit, kept for the sum
+  Vector *gen = vec_get(ms, n);  //Group generate, ends as the carry out of each bit
+  Vector *prop = vec_get(ms, n); //Group propagate
+  Gia_Lit_t *G = gen->symWord;
+  Gia_Lit_t *P = prop->symWord;
+  
+  for(i = 0; i < n; i++) {
+    Gia_Lit_t yi = invert_y ? Abc_LitNot(y[i]) : y[i];
+    G[i] = Gia_ManHashAnd(ms->ntk, x[i], yi);
+    P[i] = Gia_ManHashXor(ms->ntk, x[i], yi);
+    half->symWord[i] = P[i];
+  }
+  //Fold the carry in into bit 0 so every group below starts at bit 0
+  G[0] = Gia_ManHashOr(ms->ntk, G[0], Gia_ManHashAnd(ms->ntk, P[0], carry));
+  
+  if(ms->vec_adder == VEC_ADDER_BRENT_KUNG) {
+    //Up-sweep: bit i, with i+1 a multiple of 2d, covers the 2d bits below it
+    for(d = 1; d < n; d <<= 1) {
+      for(i = 2*d-1; i < n; i += 2*d) {
+	G[i] = Gia_ManHashOr(ms->ntk, G[i], Gia_ManHashAnd(ms->ntk, P[i], G[i-d]));
+	P[i] = Gia_ManHashAnd(ms->ntk, P[i], P[i-d]);
+      }
+    }
+    //Down-sweep: extend the remaining groups to bit 0
+    for(d >>= 1; d > 0; d >>= 1) {
+      for(i = 3*d-1; i < n; i += 2*d) {
+	G[i] = Gia_ManHashOr(ms->ntk, G[i], Gia_ManHashAnd(ms->ntk, P[i], G[i-d]));
+	P[i] = Gia_ManHashAnd(ms->ntk, P[i], P[i-d]);
+      }
+    }
+  } else {
+    //Double every group each level, high bits first so G[i-d] is from the last level
+    for(d = 1; d < n; d <<= 1) {
+      for(i = n-1; i >= d; i--) {
+	G[i] = Gia_ManHashOr(ms->ntk, G[i], Gia_ManHashAnd(ms->ntk, P[i], G[i-d]));
+	P[i] = Gia_ManHashAnd(ms->ntk, P[i], P[i-d]);
+      }
+    }
+  }
+  
+  if(sum != NULL) {
+    sum[0] = Gia_ManHashXor(ms->ntk, half->symWord[0], carry);
+    for(i = 1; i < n; i++)
+      sum[i] = Gia_ManHashXor(ms->ntk, half->symWord[i], G[i-1]);
+  }
+  
+  carry = G[n-1];
+  vec_release(ms, prop);
+  vec_release(ms, gen);
+  vec_release(ms, half);
+  return carry;
+}
+
 //BV-Add
 Vector *vec_add(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_ADD, x, y);
+  if(ret != NULL) return ret;
+  if(vec_term_wanted(ms, x, y)) return vec_term_binary(ms, VEC_TERM_ADD, x, y);
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
     if(!y->isSymbolic) {
       //Concrete case
-      uintmax_t x_ze = int_zextend(x->conWord, x->size);
-      uintmax_t y_ze = int_zextend(y->conWord, y->size);
-      ret->conWord = x_ze + y_ze;
+      if(x->size > WORD_BITS) {
+	//Ripple the carry one word at a time
+	uintmax_t carry = 0;
+	for(i = 0; i < VEC_LIMBS(x->size); i++) {
+	  uintmax_t sum = x->conWords[i] + carry;
+	  carry = (sum < carry);
+	  ret->conWords[i] = sum + y->conWords[i];
+	  carry |= (ret->conWords[i] < sum);
+	}
+	vec_con_trim(ret);
+      } else {
+	uintmax_t x_ze = int_zextend(x->conWord, x->size);
+	uintmax_t y_ze = int_zextend(y->conWord, y->size);
+	ret->conWord = x_ze + y_ze;
+      }
       ret->isSymbolic = 0;
       return ret;
     } else {
@@ -1424,41 +2406,74 @@ Vector *vec_add(machine_state *ms, Vector *x, Vector *y) {
   }
   
   //Symbolic case
+  if(vec_memo_find(ms, VEC_OP_ADD, x, y, ret)) return ret;
   ret->isSymbolic = 1;
   Gia_Lit_t carry = Gia_ManConst0Lit(); //Carry flag is initially false
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
-  for(i = 0; i < x->size; i++) {
+  
+  //Add the known low bits, and the known high bits once the carry into
+  //them is constant, as words. Only the unknown bit range is ripple-added.
+  uintmax_t xm = 0, xv = 0, ym = 0, yv = 0;
+  uintmax_t lo = 0, hi = x->size;
+  if(x->size <= WORD_BITS) {
+    vec_known_bits(x, &xm, &xv);
+    vec_known_bits(y, &ym, &yv);
+    uintmax_t unknown = int_zextend(~(xm & ym), x->size);
+    if(unknown == 0) {
+      ret->conWord = xv + yv;
+      ret->isSymbolic = 0;
+      return ret;
+    }
+    lo = int_lsb_index(unknown);
+    hi = int_msb_index(unknown) + 1;
+    if(lo > 0) {
+      uintmax_t sum = int_zextend(xv, lo) + int_zextend(yv, lo);
+      for(i = 0; i < lo; i++)
+	ret->symWord[i] = ((sum >> i) & 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+      carry = ((sum >> lo) & 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+    }
+  }
+  
+  if(ms->vec_adder != VEC_ADDER_RIPPLE)
+    vec_prefix_add(ms, ret->symWord+lo, x->symWord+lo, y->symWord+lo, x->size-lo, carry, 0);
+  else for(i = lo; i < x->size; i++) {
+    if(i >= hi && Gia_ManIsConstLit(carry)) {
+      uintmax_t sum = (xv >> i) + (yv >> i) + Gia_ManIsConst1Lit(carry);
+      for(; i < x->size; i++, sum >>= 1)
+	ret->symWord[i] = (sum & 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+      break;
+    }
     ret->symWord[i] = Gia_ManHashXor(ms->ntk, carry, Gia_ManHashXor(ms->ntk, x->symWord[i], y->symWord[i]));
     if(i < x->size-1) {
       carry = Gia_ManHashMux(ms->ntk, carry,
 		       Gia_ManHashOr(ms->ntk, x->symWord[i], y->symWord[i]),
 		       Gia_ManHashAnd(ms->ntk, x->symWord[i], y->symWord[i]));
     }
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
-    }
   }
   
-  if(!isSymbolic)
+  if(lits_all_const(ret->symWord, ret->size))
     vec_sym_to_con(ms, ret);
   else ret->isSymbolic = 1;
   
-  return ret;   
+  vec_offset_note(ms, x, y, ret);
+  return vec_memo_save(ms, VEC_OP_ADD, x, y, ret);
 }
 
 //BV-Carry
 Gia_Lit_t vec_carry(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i;
+  vec_force(ms, x);
+  vec_force(ms, y);
   
   if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
+    if(!y->isSymbolic && x->size <= WORD_BITS) {
       //Concrete case
       uintmax_t mask = ((uintmax_t)~0)>>(WORD_BITS - x->size);
       uintmax_t sum = (x->conWord + y->conWord) & mask;
       return (sum < (x->conWord & mask) || sum < (y->conWord & mask)) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
     } else {
       vec_calc_sym(ms, x);
+      if(!y->isSymbolic) vec_calc_sym(ms, y); //Wider than WORD_BITS
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
@@ -1466,25 +2481,61 @@ Gia_Lit_t vec_carry(machine_state *ms, Vector *x, Vector *y) {
   
   //Symbolic case
   Gia_Lit_t carry = Gia_ManConst0Lit(); //Carry flag is initially false
-  for(i = 0; i < x->size; i++) {
+  if(vec_memo_lookup(ms, VEC_OP_CARRY, x, y, &carry, 1)) return carry;
+  if(ms->vec_adder != VEC_ADDER_RIPPLE)
+    carry = vec_prefix_add(ms, NULL, x->symWord, y->symWord, x->size, carry, 0);
+  else for(i = 0; i < x->size; i++) {
     //Majority vote
     carry = Gia_ManHashMux(ms->ntk, carry,
 		       Gia_ManHashOr(ms->ntk, x->symWord[i], y->symWord[i]),
 		       Gia_ManHashAnd(ms->ntk, x->symWord[i], y->symWord[i]));
   }
   
+  vec_memo_store(ms, VEC_OP_CARRY, x, y, &carry, 1);
   return carry;
 }
 
+//Literals of x-y into 'diff', from the circuit ms->vec_adder selects; x and
+//y must have valid literals. Returns the borrow out of the top bit and sets
+//*borrow_top to the borrow into it.
+Gia_Lit_t vec_sub_lits(machine_state *ms, Gia_Lit_t *diff, Vector *x, Vector *y, Gia_Lit_t *borrow_top) {
+  uintmax_t i, n = x->size;
+  Gia_Lit_t borrow = Gia_ManConst0Lit(); //borrow flag is initially false
+  
+  if(ms->vec_adder != VEC_ADDER_RIPPLE) {
+    //x - y = x + ~y + 1, and a borrow is a missing carry
+    borrow = Abc_LitNot(vec_prefix_add(ms, diff, x->symWord, y->symWord, n, Gia_ManConst1Lit(), 1));
+    *borrow_top = Gia_ManHashXor(ms->ntk, diff[n-1], Gia_ManHashXor(ms->ntk, x->symWord[n-1], y->symWord[n-1]));
+    return borrow;
+  }
+  
+  for(i = 0; i < n; i++) {
+    if(i == n-1) *borrow_top = borrow;
+    Gia_Lit_t top_bit = Gia_ManHashMux(ms->ntk, borrow,
+				    Abc_LitNot(x->symWord[i]),
+				    x->symWord[i]);
+    borrow = Gia_ManHashMux(ms->ntk, x->symWord[i],
+			Gia_ManHashAnd(ms->ntk, borrow, y->symWord[i]),
+			Gia_ManHashOr(ms->ntk, borrow, y->symWord[i]));
+    diff[i] = Gia_ManHashXor(ms->ntk, top_bit, y->symWord[i]);
+  }
+  return borrow;
+}
+
 //BV-Subtract
 Vector *vec_sub(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
-  uintmax_t i;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_SUB, x, y);
+  if(ret != NULL) return ret;
+  if(vec_term_wanted(ms, x, y)) return vec_term_binary(ms, VEC_TERM_SUB, x, y);
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  ret = vec_get(ms, x->size);
   
   if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
+    if(!y->isSymbolic && x->size <= WORD_BITS) {
       //Concrete case
       uintmax_t x_ze = int_zextend(x->conWord, x->size);
       uintmax_t y_ze = int_zextend(y->conWord, y->size);
@@ -1493,32 +2544,306 @@ Vector *vec_sub(machine_state *ms, Vector *x, Vector *y) {
       return ret;
     } else {
       vec_calc_sym(ms, x);
+      if(!y->isSymbolic) vec_calc_sym(ms, y); //Wider than WORD_BITS
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
   }
   
   //Symbolic case
-  Gia_Lit_t borrow = Gia_ManConst0Lit(); //borrow flag is initially false
-  uint8_t isSymbolic = (ret->size > WORD_BITS);
+  if(vec_memo_find(ms, VEC_OP_SUB, x, y, ret)) return ret;
+  Gia_Lit_t borrow_top;
+  vec_sub_lits(ms, ret->symWord, x, y, &borrow_top);
+  
+  if(lits_all_const(ret->symWord, ret->size))
+    vec_sym_to_con(ms, ret);
+  else ret->isSymbolic = 1;
+  
+  return vec_memo_save(ms, VEC_OP_SUB, x, y, ret);
+}
+
+//ms->vecCmpLast holds the flags of the last symbolic compare whatever
+//ms->vec_memo says, as a CMP is read by several flag ops (INT_LESS,
+//INT_SLESS, INT_SBORROW, ...) on the same operands in a row
+uint8_t vec_cmp_last_find(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t *flags) {
+  vec_memo_entry *e = &ms->vecCmpLast;
+  if(e->lits == NULL || e->x_size != x->size ||
+     !vec_memo_match(e->lits, x) || !vec_memo_match(e->lits + x->size, y))
+    return 0;
+  memcpy(flags, e->lits + 2*x->size, VEC_CMP_FLAGS * sizeof(Gia_Lit_t));
+  return 1;
+}
+
+void vec_cmp_last_store(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t *flags) {
+  uintmax_t i;
+  vec_memo_entry *e = &ms->vecCmpLast;
+  if(e->lits == NULL || e->x_size != x->size)
+    e->lits = (Gia_Lit_t *)realloc(e->lits, (2*x->size + VEC_CMP_FLAGS) * sizeof(Gia_Lit_t));
+  e->x_size = x->size;
+  e->y_size = y->size;
+  e->r_size = VEC_CMP_FLAGS;
   for(i = 0; i < x->size; i++) {
-    Gia_Lit_t top_bit = Gia_ManHashMux(ms->ntk, borrow,
-				    Abc_LitNot(x->symWord[i]),
-				    x->symWord[i]);
-    borrow = Gia_ManHashMux(ms->ntk, x->symWord[i],
-			Gia_ManHashAnd(ms->ntk, borrow, y->symWord[i]),
-			Gia_ManHashOr(ms->ntk, borrow, y->symWord[i]));
-    ret->symWord[i] = Gia_ManHashXor(ms->ntk, top_bit, y->symWord[i]);
-    if(!isSymbolic && !Gia_ManIsConstLit(ret->symWord[i])) {
-      isSymbolic = 1;
+    e->lits[i] = vec_memo_lit(x, i);
+    e->lits[x->size + i] = vec_memo_lit(y, i);
+  }
+  memcpy(e->lits + 2*x->size, flags, VEC_CMP_FLAGS * sizeof(Gia_Lit_t));
+}
+
+//Flags of x-y (VEC_CMP_CF, ZF, SF and OF) from one subtractor, the one
+//vec_sub builds, so a compare and the subtraction next to it share gates.
+//The flags of the last operand pair are kept in ms->vecCmpLast, so the
+//several pcode ops one compare lowers to only build it once, memo cache or
+//not; the memo cache also keeps the difference for a later vec_sub.
+void vec_compare_flags(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t *flags) {
+  assert(x->size == y->size);
+  uintmax_t n = x->size;
+  
+  if(vec_same(ms, x, y) && vec_rule_fire(ms, VEC_RULE_SELF)) {
+    flags[VEC_CMP_CF] = Gia_ManConst0Lit();
+    flags[VEC_CMP_ZF] = Gia_ManConst1Lit();
+    flags[VEC_CMP_SF] = Gia_ManConst0Lit();
+    flags[VEC_CMP_OF] = Gia_ManConst0Lit();
+    return;
+  }
+  vec_force(ms, x);
+  vec_force(ms, y);
+  
+  if(!x->isSymbolic && !y->isSymbolic && n <= WORD_BITS) {
+    //Concrete case
+    uintmax_t x_ze = int_zextend(x->conWord, n);
+    uintmax_t y_ze = int_zextend(y->conWord, n);
+    uintmax_t diff = int_zextend(x_ze - y_ze, n);
+    uintmax_t sign = ((uintmax_t)1) << (n-1);
+    flags[VEC_CMP_CF] = (x_ze < y_ze) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+    flags[VEC_CMP_ZF] = (x_ze == y_ze) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+    flags[VEC_CMP_SF] = (diff & sign) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+    flags[VEC_CMP_OF] = ((x_ze ^ y_ze) & (x_ze ^ diff) & sign) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+    return;
+  }
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  if(!y->isSymbolic) vec_calc_sym(ms, y);
+  
+  //Symbolic case
+  if(vec_cmp_last_find(ms, x, y, flags)) return;
+  if(vec_memo_lookup(ms, VEC_OP_CMP, x, y, flags, VEC_CMP_FLAGS)) {
+    vec_cmp_last_store(ms, x, y, flags);
+    return;
+  }
+  Vector *diff = vec_get(ms, n);
+  vec_unshare(ms, diff);
+  Gia_Lit_t borrow_top;
+  flags[VEC_CMP_CF] = vec_sub_lits(ms, diff->symWord, x, y, &borrow_top);
+  flags[VEC_CMP_ZF] = vec_equal(ms, x, y); //Shallower than a test of the difference
+  flags[VEC_CMP_SF] = diff->symWord[n-1];
+  flags[VEC_CMP_OF] = Gia_ManHashXor(ms->ntk, borrow_top, flags[VEC_CMP_CF]);
+  
+  vec_memo_store(ms, VEC_OP_SUB, x, y, diff->symWord, n);
+  vec_memo_store(ms, VEC_OP_CMP, x, y, flags, VEC_CMP_FLAGS);
+  vec_cmp_last_store(ms, x, y, flags);
+  vec_release(ms, diff);
+}
+
+//One flag (VEC_CMP_CF, ZF, SF, OF) or ordered predicate (VEC_CMP_ULE,
+//SLT, SLE) of x against y. x < y unsigned is VEC_CMP_CF.
+Gia_Lit_t vec_compare(machine_state *ms, Vector *x, Vector *y, uint8_t pred) {
+  Gia_Lit_t flags[VEC_CMP_FLAGS];
+  vec_compare_flags(ms, x, y, flags);
+  
+  switch(pred) {
+  case VEC_CMP_ULE:
+    return Gia_ManHashOr(ms->ntk, flags[VEC_CMP_CF], flags[VEC_CMP_ZF]);
+  case VEC_CMP_SLT:
+    return Gia_ManHashXor(ms->ntk, flags[VEC_CMP_SF], flags[VEC_CMP_OF]);
+  case VEC_CMP_SLE:
+    return Gia_ManHashOr(ms->ntk, Gia_ManHashXor(ms->ntk, flags[VEC_CMP_SF], flags[VEC_CMP_OF]), flags[VEC_CMP_ZF]);
+  default:
+    assert(pred < VEC_CMP_FLAGS);
+    return flags[pred];
+  }
+}
+
+//BV-Multiply by a constant. c is recoded into canonical signed digits
+//(non-adjacent form) and x is shifted to each non-zero digit; the positive
+//terms are summed, then the sum of the negative terms is subtracted. That
+//is one adder per non-zero digit after the first, at most half of c's bits.
+Vector *vec_mult_const(machine_state *ms, Vector *x, Vector *c) {
+  assert(x->size == c->size);
+  assert(!c->isSymbolic);
+  uintmax_t i, k;
+  vec_force(ms, x);
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  
+  Vector *pos = NULL; //Sum of the terms for +1 digits
+  Vector *neg = NULL; //Sum of the terms for -1 digits
+  Vector *term = vec_get(ms, x->size);
+  uint8_t carry = 0;
+  
+  for(i = 0; i < x->size; i++) {
+    uint8_t bit = vec_con_getbits(c, i, 1) + carry;
+    int8_t digit = 0;
+    if(bit == 1) {
+      //A run of ones becomes +1 above the run and -1 at its bottom
+      if(i+1 < x->size && vec_con_getbits(c, i+1, 1)) { digit = -1; carry = 1; }
+      else { digit = 1; carry = 0; }
+    } else carry = (bit == 2);
+    if(digit == 0) continue;
+    
+    //term = x << i
+    for(k = 0; k < i; k++)
+      term->symWord[k] = Gia_ManConst0Lit();
+    for(; k < x->size; k++)
+      term->symWord[k] = x->symWord[k-i];
+    term->isSymbolic = 1;
+    
+    Vector **sum = (digit > 0) ? &pos : &neg;
+    if(*sum == NULL) {
+      *sum = term;
+      term = vec_get(ms, x->size);
+    } else {
+      Vector *tmp = vec_add(ms, *sum, term);
+      vec_release(ms, *sum);
+      *sum = tmp;
     }
   }
+  vec_release(ms, term);
   
-  if(!isSymbolic)
-    vec_sym_to_con(ms, ret);
-  else ret->isSymbolic = 1;
+  Vector *ret;
+  if(pos == NULL && neg == NULL) return vec_getConstant(ms, 0, x->size);
+  else if(pos == NULL) {
+    ret = vec_negate(ms, neg);
+    vec_release(ms, neg);
+  } else if(neg != NULL) {
+    ret = vec_sub(ms, pos, neg);
+    vec_release(ms, pos);
+    vec_release(ms, neg);
+  } else ret = pos;
+  
+  if(ret->isSymbolic)
+    vec_sym_to_con_attempt(ms, ret);
   
-  return ret;   
+  return ret;
+}
+
+//BV-High half of the 2n-bit product of n-bit x and the concrete c. For
+//each set bit i of c, x is added to bits i..i+n-1 of the running sum and
+//the carry becomes bit i+n; the bits below i are already final, so every
+//adder is n bits wide.
+Vector *vec_mult_high_const(machine_state *ms, Vector *x, Vector *c) {
+  assert(x->size == c->size);
+  assert(!c->isSymbolic);
+  uintmax_t i, n = x->size;
+  vec_force(ms, x);
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  
+  Gia_Lit_t *sum = (Gia_Lit_t *)malloc(2*n * sizeof(Gia_Lit_t));
+  for(i = 0; i < 2*n; i++)
+    sum[i] = Gia_ManConst0Lit();
+  Vector *window = vec_get(ms, n);
+  uint8_t first = 1;
+  
+  for(i = 0; i < n; i++) {
+    if(!vec_con_getbits(c, i, 1)) continue;
+    if(first) {
+      //Nothing to add to yet
+      memcpy(&sum[i], x->symWord, n * sizeof(Gia_Lit_t));
+      first = 0;
+      continue;
+    }
+    memcpy(window->symWord, &sum[i], n * sizeof(Gia_Lit_t));
+    window->isSymbolic = 1;
+    Vector *added = vec_add(ms, window, x);
+    vec_force(ms, added); //A term in lazy mode
+    if(!added->isSymbolic) vec_calc_sym(ms, added);
+    sum[i+n] = vec_carry(ms, window, x);
+    memcpy(&sum[i], added->symWord, n * sizeof(Gia_Lit_t));
+    vec_release(ms, added);
+  }
+  vec_release(ms, window);
+  
+  Vector *ret = vec_get(ms, n);
+  memcpy(ret->symWord, &sum[n], n * sizeof(Gia_Lit_t));
+  free(sum);
+  if(!vec_sym_to_con_attempt(ms, ret))
+    ret->isSymbolic = 1;
+  
+  return ret;
+}
+
+//BV-Multiply of two symbolic vectors with a Wallace tree. The partial
+//products are kept as columns of bits of equal weight. Each stage feeds
+//every three bits of a column to a full adder (sum stays, carry moves up
+//a column) and a leftover pair to a half adder, until no column holds
+//more than two bits. A prefix adder then sums the two remaining rows.
+//Carries out of the top column are dropped, as the product is truncated.
+Vector *vec_mult_wallace(machine_state *ms, Vector *x, Vector *y) {
+  assert(x->size == y->size);
+  uintmax_t i, j, k;
+  vec_force(ms, x);
+  vec_force(ms, y);
+  uintmax_t n = x->size;
+  uintmax_t cap = 2*n; //Bits one column may hold
+  
+  Gia_Lit_t *cur = (Gia_Lit_t *)malloc(n * cap * sizeof(Gia_Lit_t));
+  Gia_Lit_t *next = (Gia_Lit_t *)malloc(n * cap * sizeof(Gia_Lit_t));
+  uintmax_t *height = (uintmax_t *)calloc(n, sizeof(uintmax_t));
+  uintmax_t *next_height = (uintmax_t *)calloc(n, sizeof(uintmax_t));
+  uintmax_t tallest = 0;
+  
+  for(j = 0; j < n; j++) {
+    for(i = 0; i <= j; i++) {
+      Gia_Lit_t pp = Gia_ManHashAnd(ms->ntk, x->symWord[i], y->symWord[j-i]);
+      if(!Gia_ManIsConst0Lit(pp)) cur[j*cap + height[j]++] = pp;
+    }
+    if(height[j] > tallest) tallest = height[j];
+  }
+  
+  while(tallest > 2) {
+    memset(next_height, 0, n * sizeof(uintmax_t));
+    for(j = 0; j < n; j++) {
+      Gia_Lit_t *col = cur + j*cap;
+      for(k = 0; k+3 <= height[j] || (k+2 == height[j] && height[j] > 2); k += 3) {
+	Gia_Lit_t a = col[k], b = col[k+1];
+	Gia_Lit_t c = (k+2 < height[j]) ? col[k+2] : Gia_ManConst0Lit();
+	Gia_Lit_t sum = Gia_ManHashXor(ms->ntk, Gia_ManHashXor(ms->ntk, a, b), c);
+	if(!Gia_ManIsConst0Lit(sum)) next[j*cap + next_height[j]++] = sum;
+	if(j+1 < n) {
+	  //Majority vote
+	  Gia_Lit_t carry = Gia_ManHashMux(ms->ntk, c, Gia_ManHashOr(ms->ntk, a, b), Gia_ManHashAnd(ms->ntk, a, b));
+	  if(!Gia_ManIsConst0Lit(carry)) next[(j+1)*cap + next_height[j+1]++] = carry;
+	}
+      }
+      for(; k < height[j]; k++)
+	next[j*cap + next_height[j]++] = col[k];
+      assert(next_height[j] <= cap);
+    }
+    
+    Gia_Lit_t *tmp = cur; cur = next; next = tmp;
+    uintmax_t *tmp_height = height; height = next_height; next_height = tmp_height;
+    tallest = 0;
+    for(j = 0; j < n; j++)
+      if(height[j] > tallest) tallest = height[j];
+  }
+  
+  Vector *row0 = vec_get(ms, n);
+  Vector *row1 = vec_get(ms, n);
+  for(j = 0; j < n; j++) {
+    row0->symWord[j] = (height[j] > 0) ? cur[j*cap] : Gia_ManConst0Lit();
+    row1->symWord[j] = (height[j] > 1) ? cur[j*cap + 1] : Gia_ManConst0Lit();
+  }
+  free(next_height);
+  free(height);
+  free(next);
+  free(cur);
+  
+  Vector *ret = vec_get(ms, n);
+  vec_prefix_add(ms, ret->symWord, row0->symWord, row1->symWord, n, Gia_ManConst0Lit(), 0);
+  vec_release(ms, row1);
+  vec_release(ms, row0);
+  
+  if(!vec_sym_to_con_attempt(ms, ret))
+    ret->isSymbolic = 1;
+  
+  return ret;
 }
 
 //BV-Multiply
@@ -1526,29 +2851,44 @@ Vector *vec_mult(machine_state *ms, Vector *x, Vector *y) {
   assert(x->size == y->size);
   uintmax_t i, j;
   
-  Vector *ret = vec_get(ms, x->size);
+  Vector *ret = vec_rewrite_binary(ms, VEC_OP_MULT, x, y);
+  if(ret != NULL) return ret;
+  if(vec_term_wanted(ms, x, y)) return vec_term_binary(ms, VEC_TERM_MULT, x, y);
+  vec_force(ms, x);
+  vec_force(ms, y);
   
-  if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
-      //Concrete case
-      uintmax_t x_ze = int_zextend(x->conWord, x->size);
-      uintmax_t y_ze = int_zextend(y->conWord, y->size);
-      ret->conWord = x_ze * y_ze;
-      ret->isSymbolic = 0;
-      return ret;
-    } else {
-      vec_calc_sym(ms, x);
-    }
+  ret = vec_get(ms, x->size);
+  
+  if(!x->isSymbolic && !y->isSymbolic && x->size <= WORD_BITS) {
+    //Concrete case
+    uintmax_t x_ze = int_zextend(x->conWord, x->size);
+    uintmax_t y_ze = int_zextend(y->conWord, y->size);
+    ret->conWord = x_ze * y_ze;
+    ret->isSymbolic = 0;
+    return ret;
+  }
+  
+  if(vec_memo_find(ms, VEC_OP_MULT, x, y, ret)) return ret;
+  
+  if(!x->isSymbolic && y->isSymbolic) {
+    vec_release(ms, ret);
+    return vec_memo_save(ms, VEC_OP_MULT, x, y, vec_mult_const(ms, y, x));
   } else if(!y->isSymbolic) {
-    vec_calc_sym(ms, y);
+    vec_release(ms, ret);
+    return vec_memo_save(ms, VEC_OP_MULT, x, y, vec_mult_const(ms, x, y)); //x may be wider than WORD_BITS
   }
   
   //Symbolic case
+  if(ms->vec_multiplier == VEC_MULT_WALLACE) {
+    vec_release(ms, ret);
+    return vec_memo_save(ms, VEC_OP_MULT, x, y, vec_mult_wallace(ms, x, y));
+  }
+  
   vec_setValue(ms, ret, 0);
   ret->isSymbolic = 1;
   
   Vector *tmp_vec = vec_get(ms, ret->size);
-  vec_copy(ms, tmp_vec, ret);
+  vec_copy_private(ms, tmp_vec, ret);
   
   for(j = 0; j < x->size; j++) {
     if(Gia_ManIsConst0Lit(y->symWord[j]))
@@ -1565,7 +2905,8 @@ Vector *vec_mult(machine_state *ms, Vector *x, Vector *y) {
     }
     
     if(Gia_ManIsConst1Lit(y->symWord[j])) {
-      vec_copy(ms, ret, tmp_vec);
+      //Only bits j and up were summed; bits below j of tmp_vec may be stale
+      memcpy(&ret->symWord[j], &tmp_vec->symWord[j], (x->size - j) * sizeof(Gia_Lit_t ));
     } else {
       for(i = 0; i < (x->size - j); i++) {
 	ret->symWord[i+j] = Gia_ManHashMux(ms->ntk, y->symWord[j],
@@ -1580,33 +2921,203 @@ Vector *vec_mult(machine_state *ms, Vector *x, Vector *y) {
   
   vec_release(ms, tmp_vec);
   
-  return ret;
+  return vec_memo_save(ms, VEC_OP_MULT, x, y, ret);
+}
+
+//BV-Unsigned quotient and remainder of x by the concrete divisor d, d at
+//most WORD_BITS wide. Either of quot and rem may be NULL. A power of two
+//is a shift and a mask. Any other d uses x/d == (x*m) >> (n+s) for n-bit
+//x, s = ceil(log2(d)) and m = ceil(2^(n+s)/d), which has n+1 bits. Only
+//the high half of x times the low n bits of m is built, with n-bit adders
+//(vec_mult_high_const), and the top bit of m is added back as x. The
+//remainder is x - (x/d)*d.
+void vec_divmod_const(machine_state *ms, Vector *x, Vector *d, Vector **quot, Vector **rem) {
+  assert(x->size == d->size);
+  assert(!d->isSymbolic && d->size <= WORD_BITS);
+  uintmax_t i, n = x->size;
+  uintmax_t divisor = int_zextend(d->conWord, d->size);
+  vec_force(ms, x);
+  
+  if(divisor == 0) {
+    //Same as the concrete case
+    if(quot != NULL) *quot = vec_getConstant(ms, ~((uintmax_t)0), n);
+    if(rem != NULL) *rem = vec_dup(ms, x);
+    return;
+  }
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  
+  if((divisor & (divisor-1)) == 0) {
+    uintmax_t k = int_msb_index(divisor);
+    if(quot != NULL) {
+      *quot = vec_get(ms, n);
+      for(i = 0; i < n; i++)
+	(*quot)->symWord[i] = (i+k < n) ? x->symWord[i+k] : Gia_ManConst0Lit();
+      if(!vec_sym_to_con_attempt(ms, *quot))
+	(*quot)->isSymbolic = 1;
+    }
+    if(rem != NULL) {
+      *rem = vec_get(ms, n);
+      for(i = 0; i < n; i++)
+	(*rem)->symWord[i] = (i < k) ? x->symWord[i] : Gia_ManConst0Lit();
+      if(!vec_sym_to_con_attempt(ms, *rem))
+	(*rem)->isSymbolic = 1;
+    }
+    return;
+  }
+  
+  //m = floor(2^(n+s)/d) + 1 by long division; d is not a power of two.
+  //2^n < m < 2^(n+1), so only its low n bits m' are kept in 'magic'
+  uintmax_t s = int_msb_index(divisor-1) + 1;
+  Vector *magic = vec_getConstant(ms, 0, n);
+  uintmax_t partial = 1; //Leading one of 2^(n+s)
+  for(i = n+s; i-- > 0; ) {
+    //partial = 2*partial, without overflowing when d is above 2^(WORD_BITS-1)
+    if(partial >= divisor - partial) {
+      partial -= divisor - partial;
+      if(i < n) vec_con_setbits(magic, i, 1, 1);
+    } else partial <<= 1;
+  }
+  for(i = 0; i < n; i++) {
+    uint8_t bit = vec_con_getbits(magic, i, 1);
+    vec_con_setbits(magic, i, 1, !bit);
+    if(!bit) break;
+  }
+  
+  //x*m >> (n+s) == (x + t) >> s for t = x*m' >> n. t <= x, so
+  //((x - t) >> 1) + t is (x + t) >> 1 without overflowing n bits; s >= 2.
+  Vector *t = vec_mult_high_const(ms, x, magic);
+  Vector *spread = vec_sub(ms, x, t);
+  Vector *half = vec_selectBits(ms, spread, n-1, 1);
+  Vector *half_wide = vec_zextend(ms, half, n);
+  Vector *mid = vec_add(ms, half_wide, t);
+  Vector *quot_bits = vec_selectBits(ms, mid, n-s+1, s-1);
+  Vector *q = vec_zextend(ms, quot_bits, n);
+  vec_release(ms, quot_bits);
+  vec_release(ms, mid);
+  vec_release(ms, half_wide);
+  vec_release(ms, half);
+  vec_release(ms, spread);
+  vec_release(ms, t);
+  vec_release(ms, magic);
+  
+  if(rem != NULL) {
+    Vector *multiple = vec_mult_const(ms, q, d);
+    *rem = vec_sub(ms, x, multiple);
+    vec_release(ms, multiple);
+  }
+  if(quot != NULL) *quot = q;
+  else vec_release(ms, q);
+}
+
+//BV-Signed quotient and remainder of x by the non-zero concrete divisor d,
+//rounding toward zero as pINT_SDIV and pINT_SREM do. Either of quot and
+//rem may be NULL. For |d| == 2^k the quotient is
+//(x + (x < 0 ? 2^k-1 : 0)) >> k, shifted arithmetically, and negated for
+//negative d. Other divisors divide |x| by |d| with vec_divmod_const and
+//restore the signs.
+void vec_sdivmod_const(machine_state *ms, Vector *x, Vector *d, Vector **quot, Vector **rem) {
+  assert(x->size == d->size);
+  assert(!d->isSymbolic && d->size <= WORD_BITS);
+  uintmax_t i, n = x->size;
+  intmax_t divisor = int_sextend(d->conWord, d->size, WORD_BITS);
+  uintmax_t magnitude = (divisor < 0) ? -(uintmax_t)divisor : (uintmax_t)divisor;
+  vec_force(ms, x);
+  magnitude = int_zextend(magnitude, n);
+  assert(magnitude != 0);
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  Gia_Lit_t sign = x->symWord[n-1];
+  
+  if((magnitude & (magnitude-1)) == 0) {
+    uintmax_t k = int_msb_index(magnitude);
+    Vector *bias = vec_get(ms, n);
+    for(i = 0; i < n; i++)
+      bias->symWord[i] = (i < k) ? sign : Gia_ManConst0Lit();
+    bias->isSymbolic = 1;
+    Vector *biased = vec_add(ms, x, bias);
+    vec_release(ms, bias);
+    vec_force(ms, biased); //A term in lazy mode
+    if(!biased->isSymbolic) vec_calc_sym(ms, biased);
+    
+    Vector *q = vec_get(ms, n);
+    for(i = 0; i < n; i++)
+      q->symWord[i] = (i+k < n) ? biased->symWord[i+k] : biased->symWord[n-1];
+    vec_release(ms, biased);
+    if(!vec_sym_to_con_attempt(ms, q))
+      q->isSymbolic = 1;
+    
+    if(rem != NULL) {
+      //x - (q << k)
+      Vector *multiple = vec_get(ms, n);
+      if(!q->isSymbolic) vec_calc_sym(ms, q); //Read as literals below
+      for(i = 0; i < n; i++)
+	multiple->symWord[i] = (i >= k) ? q->symWord[i-k] : Gia_ManConst0Lit();
+      multiple->isSymbolic = 1;
+      *rem = vec_sub(ms, x, multiple);
+      vec_release(ms, multiple);
+    }
+    if(quot == NULL) vec_release(ms, q);
+    else if(divisor > 0) *quot = q;
+    else {
+      *quot = vec_negate(ms, q);
+      vec_release(ms, q);
+    }
+    return;
+  }
+  
+  Vector *d_abs = vec_getConstant(ms, magnitude, n);
+  Vector *x_abs = vec_abs(ms, x);
+  Vector *q, *r;
+  vec_divmod_const(ms, x_abs, d_abs, (quot != NULL) ? &q : NULL, (rem != NULL) ? &r : NULL);
+  if(quot != NULL) {
+    //Negative when the signs differ
+    Vector *negated = vec_negate(ms, q);
+    *quot = vec_ite(ms, (divisor < 0) ? Abc_LitNot(sign) : sign, negated, q);
+    vec_release(ms, negated);
+    vec_release(ms, q);
+  }
+  if(rem != NULL) {
+    //Negative when x is
+    Vector *negated = vec_negate(ms, r);
+    *rem = vec_ite(ms, sign, negated, r);
+    vec_release(ms, negated);
+    vec_release(ms, r);
+  }
+  vec_release(ms, x_abs);
+  vec_release(ms, d_abs);
 }
 
-//BV-Quotient|Remainder
-Vector *vec_quot_rem(machine_state *ms, Vector *x, Vector *y, uint8_t quot_rem) {
+//BV-Unsigned quotient and remainder from one restoring division circuit.
+//Either of quot and rem may be NULL. Division by zero gives a quotient of
+//all ones and a remainder of x.
+void vec_divmod(machine_state *ms, Vector *x, Vector *y, Vector **quot, Vector **rem) {
   assert(x->size == y->size);
   intmax_t i, j; //Must be signed integers
+  vec_force(ms, x);
+  vec_force(ms, y);
   
-  Vector *ret = vec_get(ms, x->size);
+  if(x->isSymbolic && !y->isSymbolic && y->size <= WORD_BITS) {
+    vec_divmod_const(ms, x, y, quot, rem);
+    return;
+  }
   
   if(!x->isSymbolic) {
-    if(!y->isSymbolic) {
+    if(!y->isSymbolic && x->size <= WORD_BITS) {
       //Concrete case
       uintmax_t x_ze = int_zextend(x->conWord, x->size);
       uintmax_t y_ze = int_zextend(y->conWord, y->size);
-      if(y_ze == 0) ret->conWord = quot_rem ? -1 : x_ze;
-      else ret->conWord = quot_rem ? (x_ze/y_ze) : (x_ze%y_ze);
-      ret->isSymbolic = 0;
-      return ret;
+      if(quot != NULL) *quot = vec_getConstant(ms, (y_ze == 0) ? -1 : (x_ze/y_ze), x->size);
+      if(rem != NULL) *rem = vec_getConstant(ms, (y_ze == 0) ? x_ze : (x_ze%y_ze), x->size);
+      return;
     } else {
       vec_calc_sym(ms, x);
+      if(!y->isSymbolic) vec_calc_sym(ms, y); //Wider than WORD_BITS
     }
   } else if(!y->isSymbolic) {
     vec_calc_sym(ms, y);
   }
   
-  vec_copy(ms, ret, x);
+  Vector *ret = vec_get(ms, x->size);
+  vec_copy_private(ms, ret, x);
   ret->isSymbolic = 1;
   
   Vector *quot_vec = vec_get(ms, x->size);
@@ -1652,7 +3163,7 @@ Vector *vec_quot_rem(machine_state *ms, Vector *x, Vector *y, uint8_t quot_rem)
     }
     
     if(Gia_ManIsConst1Lit(quot_vec->symWord[j])) {
-      vec_copy(ms, ret, tmp_vec);
+      vec_copy_private(ms, ret, tmp_vec);
     } else {
       for(i = 0; i < x->size; i++) {
 	ret->symWord[i] = Gia_ManHashMux(ms->ntk, quot_vec->symWord[j],
@@ -1664,20 +3175,70 @@ Vector *vec_quot_rem(machine_state *ms, Vector *x, Vector *y, uint8_t quot_rem)
   
   vec_release(ms, tmp_vec);
   
-  if(quot_rem) {
-    vec_release(ms, ret);
+  if(quot != NULL) {
     vec_sym_to_con_attempt(ms, quot_vec);
-    return quot_vec;
-  }
+    *quot = quot_vec;
+  } else vec_release(ms, quot_vec);
+  
+  if(rem != NULL) {
+    vec_sym_to_con_attempt(ms, ret);
+    *rem = ret;
+  } else vec_release(ms, ret);
+}
+
+//BV-Unsigned quotient (quot_rem == 1) or remainder
+Vector *vec_quot_rem(machine_state *ms, Vector *x, Vector *y, uint8_t quot_rem) {
+  Vector *ret;
+  vec_divmod(ms, x, y, quot_rem ? &ret : NULL, quot_rem ? NULL : &ret);
+  return ret;
+}
+
+//BV-Signed quotient and remainder, rounding toward zero. Either of quot and
+//rem may be NULL. The magnitudes are divided by vec_divmod once for both.
+//Division by zero gives a quotient of zero and a remainder of x.
+void vec_sdivmod(machine_state *ms, Vector *x, Vector *y, Vector **quot, Vector **rem) {
+  assert(x->size == y->size);
+  vec_force(ms, x);
+  vec_force(ms, y);
+  if(!x->isSymbolic) vec_calc_sym(ms, x);
+  if(!y->isSymbolic) vec_calc_sym(ms, y);
   
-  vec_release(ms, quot_vec);
-  vec_sym_to_con_attempt(ms, ret);
+  Gia_Lit_t sign0 = x->symWord[x->size-1];
+  Gia_Lit_t sign1 = y->symWord[y->size-1];
   
-  return ret;   
+  Vector *x_abs = vec_abs(ms, x);
+  Vector *y_abs = vec_abs(ms, y);
+  Vector *q, *r;
+  vec_divmod(ms, x_abs, y_abs, (quot != NULL) ? &q : NULL, (rem != NULL) ? &r : NULL);
+  
+  if(quot != NULL) {
+    Vector *vec_zero = vec_getConstant(ms, 0, x->size);
+    Gia_Lit_t zerotest = vec_equal(ms, y, vec_zero);
+    Vector *negated = vec_negate(ms, q);
+    Vector *intermediate = vec_ite(ms, Gia_ManHashXor(ms->ntk, sign0, sign1), negated, q);
+    *quot = vec_ite(ms, zerotest, vec_zero, intermediate);
+    vec_release(ms, intermediate);
+    vec_release(ms, negated);
+    vec_release(ms, vec_zero);
+    vec_release(ms, q);
+  }
+  if(rem != NULL) {
+    Vector *negated = vec_negate(ms, r);
+    *rem = vec_ite(ms, sign0, negated, r);
+    vec_release(ms, negated);
+    vec_release(ms, r);
+  }
+  
+  vec_release(ms, y_abs);
+  vec_release(ms, x_abs);
 }
 
 void print_AIG(machine_state *ms, char *filename, uint8_t clean_first) {
   assert(filename != NULL);
+  if(ms->concrete_only) {
+    fprintf(stderr, "Warning: No AIG to write to %s in concrete-only mode\n", filename);
+    return;
+  }
   //Cleaning can help make a smaller AIG, but can destroy AIG nodes
   //needed by the machine_state. So, only clean if the machine_state
   //is no longer needed.
@@ -1705,39 +3266,39 @@ void print_AIG(machine_state *ms, char *filename, uint8_t clean_first) {
   //fprintf(stdout, "\n------*****\n\n");
 }
 
-void machine_state_update_probes(machine_state *ms) {
-  //Update probes for all literals in memory
+//Register everything in the memories on the stack, and the current one, as
+//roots. Only the current memory's probes go to the sweeper. heap_offset is
+//a root too: the malloc stubs add symbolic sizes to it and branches merge
+//it with vec_ite, so it can hold literals or (in lazy mode) a term.
+void machine_state_gc_roots(machine_state *ms) {
+  uintmax_t head;
+  gc_root_vec(ms, ms->heap_offset, 1);
   arr_stack_push(ms->memories_stack, (void *)&ms->memory);
-  ms->CurrsMemFlag++;
-  uintmax_t head = ms->memories_stack->head;
-  while(head!=0) {
+  for(head = ms->memories_stack->head; head != 0; head--)
+    sMemory_compress(ms, ((memTuple *)ms->memories_stack->mem[head])->sMem);
+  ms->CurrsMemFlag++; //After compressing, which walks with its own flags
+  for(head = ms->memories_stack->head; head != 0; head--) {
     memTuple *memories = (memTuple *)ms->memories_stack->mem[head];
-    cMemory_update_probes(ms, memories->cMem);
-    sMemory_compress(ms, memories->sMem);
-    sMemory_update_probes(ms, memories->sMem);
-    if(head == ms->memories_stack->head) {
-      cMemory_collect_probes(ms, memories->cMem); 
-      sMemory_collect_probes(ms, memories->sMem);
-    }
-    head--;
+    cMemory_gc_roots(ms, memories->cMem, head == ms->memories_stack->head);
+    sMemory_gc_roots(ms, memories->sMem, head == ms->memories_stack->head);
   }
 }
 
-void machine_state_update_from_probes(machine_state *ms) {
-  //Update literals in memory from probes
-  uintmax_t head = ms->memories_stack->head;
-  memTuple *memories = (memTuple *)ms->memories_stack->mem[head];
-  cMemory_update_from_probes(ms, memories->cMem);
-  sMemory_update_from_probes(ms, memories->sMem);
-  
+void machine_state_gc_restore(machine_state *ms) {
+  gc_roots_restore(ms);
   arr_stack_pop(ms->memories_stack);
 }
 
 //AIG cleanup / garbage collection routines
+//Only the roots and 'cond' are kept. A caller holding any other lazy
+//term (see vec_terms.c) must vec_force it first, as the term table is
+//flushed.
 Gia_Lit_t garbage_collect_ntk(machine_state *ms, Gia_Lit_t cond, uint8_t force_gc) {
   uintmax_t nNumMaxObjects = Gia_ManObjNum(ms->ntk);
   //uintmax_t nNumMaxObjects = Abc_NtkObjNumMax(ms->ntk);
 
+  if(ms->concrete_only) return cond; //Nothing to collect without an AIG
+
   //Don't garbage collect all of the time.
   if(force_gc || nNumMaxObjects > ms->nNodes_last) {
     fprintf(stdout, "GC...");
@@ -1751,9 +3312,8 @@ Gia_Lit_t garbage_collect_ntk(machine_state *ms, Gia_Lit_t cond, uint8_t force_g
     */
 
     assert(Vec_IntSize(ms->gc_probes) == 0);
-    machine_state_update_probes(ms);
-    Gia_Probe_t condProbe = get_probe_from_lit(ms, cond);
-    //collect_probe(ms, condProbe);
+    machine_state_gc_roots(ms);
+    gc_root_lit(ms, &cond, 0);
     fprintf(stdout, "Condition = %d\n", cond);
 
     //Gia_SweeperSweep(ms->ntk, ms->pOutputProbes, 1, 1000, 1);
@@ -1799,9 +3359,10 @@ Gia_Lit_t garbage_collect_ntk(machine_state *ms, Gia_Lit_t cond, uint8_t force_g
       //fprintf(stdout, "[%d -> %d]", p, get_lit_from_probe(ms, p));
     }
 
-    machine_state_update_from_probes(ms);
-    cond = get_lit_from_probe(ms, condProbe);
-    probe_free(ms, condProbe);
+    machine_state_gc_restore(ms);
+    vec_memo_flush(ms); //The sweeper may have renumbered the recorded literals
+    vec_offset_flush(ms);
+    vec_term_flush(ms); //Roots were forced by gc_root_vec; see vec_term_flush
     
     /*
     //add conditions back
@@ -1812,6 +3373,7 @@ Gia_Lit_t garbage_collect_ntk(machine_state *ms, Gia_Lit_t cond, uint8_t force_g
       Gia_SweeperCondPush(ms->ntk, pProbeId);
     }
     */
+    vec_pool_trim(ms, ms->vec_pool_budget);
     ms->nNodes_last = Gia_ManObjNum(ms->ntk) + ms->nNodes_increment;
     //ms->nNodes_last = Abc_NtkObjNumMax(ms->ntk) + ms->nNodes_increment;
   }
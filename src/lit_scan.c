@@ -0,0 +1,138 @@
+#include "vectype.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+//Scans over arrays of literals (Gia_Lit_t)
+//
+//The constant literals are 0 (false) and 1 (true), so a literal is
+//constant exactly when no bit above bit 0 is set. The AVX2 or SSE4.1
+//kernels are chosen at compile time (e.g. with -march=native); the scalar
+//loops finish the tail and stand in on other targets.
+
+//True if every literal in lits[0..n) is constant
+uint8_t lits_all_const(const Gia_Lit_t *lits, uintmax_t n) {
+  uintmax_t i = 0;
+#if defined(__AVX2__)
+  const __m256i nonconst = _mm256_set1_epi32(~1);
+  for(; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(lits + i));
+    if(!_mm256_testz_si256(v, nonconst)) return 0;
+  }
+#elif defined(__SSE4_1__)
+  const __m128i nonconst = _mm_set1_epi32(~1);
+  for(; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(lits + i));
+    if(!_mm_testz_si128(v, nonconst)) return 0;
+  }
+#endif
+  for(; i < n; i++)
+    if(!Gia_ManIsConstLit(lits[i])) return 0;
+  return 1;
+}
+
+//Pack lits[0..n), n <= WORD_BITS, into words: bit i of 'mask' is set if
+//lits[i] is constant, and bit i of 'value' if lits[i] is constant true.
+void lits_pack(const Gia_Lit_t *lits, uintmax_t n, uintmax_t *mask, uintmax_t *value) {
+  uintmax_t i = 0;
+  uintmax_t m = 0, v = 0;
+  assert(n <= WORD_BITS);
+#if defined(__AVX2__)
+  const __m256i nonconst = _mm256_set1_epi32(~1);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i zero = _mm256_setzero_si256();
+  for(; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(lits + i));
+    __m256i c = _mm256_cmpeq_epi32(_mm256_and_si256(x, nonconst), zero);
+    __m256i t = _mm256_cmpeq_epi32(x, one);
+    m |= ((uintmax_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(c))) << i;
+    v |= ((uintmax_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(t))) << i;
+  }
+#elif defined(__SSE4_1__)
+  const __m128i nonconst = _mm_set1_epi32(~1);
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i zero = _mm_setzero_si128();
+  for(; i + 4 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(lits + i));
+    __m128i c = _mm_cmpeq_epi32(_mm_and_si128(x, nonconst), zero);
+    __m128i t = _mm_cmpeq_epi32(x, one);
+    m |= ((uintmax_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(c))) << i;
+    v |= ((uintmax_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(t))) << i;
+  }
+#endif
+  for(; i < n; i++) {
+    if(Gia_ManIsConstLit(lits[i])) {
+      m |= ((uintmax_t)1) << i;
+      if(Gia_ManIsConst1Lit(lits[i]))
+	v |= ((uintmax_t)1) << i;
+    }
+  }
+  *mask = m;
+  *value = v;
+}
+
+//Expand the low n bits of 'value', n <= WORD_BITS, into constant literals
+void lits_unpack(Gia_Lit_t *lits, uintmax_t n, uintmax_t value) {
+  uintmax_t i = 0;
+  assert(n <= WORD_BITS);
+#if defined(__AVX2__)
+  const __m256i shifts = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i one = _mm256_set1_epi32(1);
+  for(; i + 8 <= n; i += 8) {
+    __m256i b = _mm256_set1_epi32((int)((value >> i) & 0xff));
+    _mm256_storeu_si256((__m256i *)(lits + i), _mm256_and_si256(_mm256_srlv_epi32(b, shifts), one));
+  }
+#elif defined(__SSE4_1__)
+  const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+  const __m128i one = _mm_set1_epi32(1);
+  for(; i + 4 <= n; i += 4) {
+    __m128i b = _mm_set1_epi32((int)((value >> i) & 0xf));
+    _mm_storeu_si128((__m128i *)(lits + i), _mm_min_epu32(_mm_and_si128(b, bits), one));
+  }
+#endif
+  for(; i < n; i++)
+    lits[i] = ((value >> i) & 1) ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+}
+
+//True if a[i] == b[i] for every i < n
+uint8_t lits_equal(const Gia_Lit_t *a, const Gia_Lit_t *b, uintmax_t n) {
+  uintmax_t i = 0;
+  if(a == b) return 1;
+#if defined(__AVX2__)
+  for(; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+    if(!_mm256_testz_si256(d, d)) return 0;
+  }
+#elif defined(__SSE4_1__)
+  for(; i + 4 <= n; i += 4) {
+    __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+    if(!_mm_testz_si128(d, d)) return 0;
+  }
+#endif
+  for(; i < n; i++)
+    if(a[i] != b[i]) return 0;
+  return 1;
+}
+
+//True if a[i] is the complement of b[i] for some i < n
+uint8_t lits_any_complement(const Gia_Lit_t *a, const Gia_Lit_t *b, uintmax_t n) {
+  uintmax_t i = 0;
+  if(a == b) return 0;
+#if defined(__AVX2__)
+  const __m256i one = _mm256_set1_epi32(1);
+  for(; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+    if(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, one)))) return 1;
+  }
+#elif defined(__SSE4_1__)
+  const __m128i one = _mm_set1_epi32(1);
+  for(; i + 4 <= n; i += 4) {
+    __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+    if(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, one)))) return 1;
+  }
+#endif
+  for(; i < n; i++)
+    if(Abc_LitNot(a[i]) == b[i]) return 1;
+  return 0;
+}
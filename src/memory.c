@@ -1,55 +1,203 @@
 #include "vectype.h"
 
 //Routines for handling concretely addressed memory
+//
+//Outside concrete-only mode a cMemory is a table of CMEM_PAGE_SIZE byte
+//pages, each allocated by the first store into it. A page that was never
+//stored to is NULL and reads as unwritten zeros. cMemory_copy shares pages
+//between the copies, counting references, and a store into a shared page
+//first gives the storing cMemory its own copy.
+//
+//A page keeps its concrete bytes packed in .bytes; only a symbolic byte has
+//a vector in its cell. Loads of written, concrete bytes within a page are
+//assembled straight from .bytes, and concrete stores write them there,
+//without a vector per byte.
+//
+//Each cMemory also marks, per page, the bytes stored to since the branch it
+//was copied for. Bytes neither side of a branch marked are the same on both,
+//so cMemory_ite merges only the marked ones. A copy starts from its
+//parent's marks and a merge keeps the union, so an enclosing merge still
+//sees every byte written inside a nested branch.
+
+#define CMEM_PAGE(offset) ((offset) >> CMEM_PAGE_BITS)
+#define CMEM_PAGE_OFFSET(offset) ((offset) & (CMEM_PAGE_SIZE-1))
+
+cMemoryPage *cMemory_page_init(machine_state *ms) {
+  uintmax_t i;
+  cMemoryPage *page = (cMemoryPage *)malloc(sizeof(cMemoryPage));
+  for(i = 0; i < CMEM_PAGE_SIZE; i++) {
+    page->cByte[i].value = NULL;
+    page->cByte[i].writtenTo = Gia_ManConst0Lit();
+  }
+  memset(page->bytes, 0, sizeof(page->bytes));
+  page->refs = 1;
+  page->flag = 0;
+  return page;
+}
 
-cMemory *cMemory_init(machine_state *ms, uintmax_t base_address, uintmax_t size) {
+//Drop one reference to 'page', freeing it with the last
+void cMemory_page_release(machine_state *ms, cMemoryPage *page) {
   uintmax_t i;
-  cMemory *cMem = (cMemory *)malloc(1 * sizeof(cMemory));
-  cMem->cByte   = (cMemoryCell *)malloc(size * sizeof(cMemoryCell));
-  for(i = 0; i < size; i++) {
-    cMem->cByte[i].value = vec_getConstant(ms, 0, BITS_IN_BYTE);
-    cMem->cByte[i].valueProbes = get_probes_from_vec(ms, cMem->cByte[i].value);    
-    cMem->cByte[i].writtenTo = Gia_ManConst0Lit();
-    cMem->cByte[i].writtenToProbe = get_probe_from_lit(ms, cMem->cByte[i].writtenTo);
+  assert(page->refs > 0);
+  if(--page->refs > 0) return;
+  for(i = 0; i < CMEM_PAGE_SIZE; i++)
+    if(page->cByte[i].value != NULL)
+      vec_release(ms, page->cByte[i].value);
+  free(page);
+}
+
+//Cell at 'offset' from the base address, NULL if its page was never stored to
+cMemoryCell *cMemory_findCell(cMemory *cMem, uintmax_t offset) {
+  cMemoryPage *page = cMem->pages[CMEM_PAGE(offset)];
+  if(page == NULL) return NULL;
+  return &page->cByte[CMEM_PAGE_OFFSET(offset)];
+}
+
+//A private copy of a shared page, in place of the caller's reference to it
+cMemoryPage *cMemory_page_unshare(machine_state *ms, cMemoryPage *page) {
+  uintmax_t i;
+  if(page->refs == 1) return page;
+  cMemoryPage *copy = cMemory_page_init(ms);
+  for(i = 0; i < CMEM_PAGE_SIZE; i++) {
+    if(page->cByte[i].value != NULL)
+      copy->cByte[i].value = vec_scope_keep(ms, vec_dup(ms, page->cByte[i].value));
+    copy->cByte[i].writtenTo = page->cByte[i].writtenTo;
   }
-  
+  memcpy(copy->bytes, page->bytes, sizeof(page->bytes));
+  cMemory_page_release(ms, page);
+  return copy;
+}
+
+//Byte 'k' of 'page' as a new vector
+Vector *cMemory_page_get(machine_state *ms, cMemoryPage *page, uintmax_t k) {
+  if(page->cByte[k].value == NULL) return vec_getConstant(ms, page->bytes[k], BITS_IN_BYTE);
+  return vec_dup(ms, page->cByte[k].value);
+}
+
+void cMemory_page_setCon(machine_state *ms, cMemoryPage *page, uintmax_t k, uint8_t byte) {
+  cMemoryCell *cell = &page->cByte[k];
+  if(cell->value != NULL) {
+    vec_release(ms, cell->value);
+    cell->value = NULL;
+  }
+  page->bytes[k] = byte;
+}
+
+//Set byte 'k' of 'page' to 'vec', which keeps a vector only if it is symbolic
+void cMemory_page_set(machine_state *ms, cMemoryPage *page, uintmax_t k, Vector *vec) {
+  cMemoryCell *cell = &page->cByte[k];
+  if(!vec->isSymbolic) cMemory_page_setCon(ms, page, k, (uint8_t)vec->conWord);
+  else if(cell->value == NULL) cell->value = vec_scope_keep(ms, vec_dup(ms, vec));
+  else vec_copy(ms, cell->value, vec);
+}
+
+//Page holding 'offset' from the base address, for a store: allocated if
+//new and copied if shared, and the byte is marked dirty
+cMemoryPage *cMemory_touchPage(machine_state *ms, cMemory *cMem, uintmax_t offset) {
+  cMemoryPage **page = &cMem->pages[CMEM_PAGE(offset)];
+  uint64_t **dirty = &cMem->dirty[CMEM_PAGE(offset)];
+  if(*page == NULL) *page = cMemory_page_init(ms);
+  else *page = cMemory_page_unshare(ms, *page);
+  if(*dirty == NULL) *dirty = (uint64_t *)calloc(CMEM_DIRTY_WORDS, sizeof(uint64_t));
+  (*dirty)[CMEM_PAGE_OFFSET(offset) / 64] |= ((uint64_t)1) << (offset % 64);
+  return *page;
+}
+
+void cMemory_storeConByte(machine_state *ms, cMemory *cMem, uintmax_t offset, uint8_t byte) {
+  cMemoryPage *page = cMemory_touchPage(ms, cMem, offset);
+  cMemory_page_setCon(ms, page, CMEM_PAGE_OFFSET(offset), byte);
+  page->cByte[CMEM_PAGE_OFFSET(offset)].writtenTo = Gia_ManConst1Lit();
+}
+
+void cMemory_storeByte(machine_state *ms, cMemory *cMem, uintmax_t offset, Vector *vec) {
+  cMemoryPage *page = cMemory_touchPage(ms, cMem, offset);
+  cMemory_page_set(ms, page, CMEM_PAGE_OFFSET(offset), vec);
+  page->cByte[CMEM_PAGE_OFFSET(offset)].writtenTo = Gia_ManConst1Lit();
+}
+
+//Forget which bytes were stored to, for when no enclosing branch will merge
+//this cMemory with another
+void cMemory_clean(machine_state *ms, cMemory *cMem) {
+  uintmax_t p;
+  if(ms->concrete_only) return;
+  for(p = 0; p < cMem->num_pages; p++) {
+    free(cMem->dirty[p]);
+    cMem->dirty[p] = NULL;
+  }
+}
+
+cMemory *cMemory_init(machine_state *ms, uintmax_t base_address, uintmax_t size) {
+  cMemory *cMem = (cMemory *)malloc(1 * sizeof(cMemory));
   cMem->size = size;
   cMem->base_address = base_address;
+  cMem->num_pages = (size + CMEM_PAGE_SIZE-1) >> CMEM_PAGE_BITS;
+  if(ms->concrete_only) {
+    //Plain bytes, no vectors or probes
+    cMem->pages   = NULL;
+    cMem->dirty   = NULL;
+    cMem->bytes   = (uint8_t *)calloc(size, sizeof(uint8_t));
+    cMem->written = (uint8_t *)calloc(size, sizeof(uint8_t));
+    return cMem;
+  }
+  cMem->bytes   = NULL;
+  cMem->written = NULL;
+  cMem->pages   = (cMemoryPage **)calloc(cMem->num_pages, sizeof(cMemoryPage *));
+  cMem->dirty   = (uint64_t **)calloc(cMem->num_pages, sizeof(uint64_t *));
+  
   return cMem;
 }
 
 void cMemory_free(machine_state *ms, cMemory *cMem) {
-  uintmax_t i;
-  for(i = 0; i < cMem->size; i++) {
-    probe_free(ms, cMem->cByte[i].writtenToProbe);
-    cMem->cByte[i].writtenToProbe = 0;
-    cMem->cByte[i].writtenTo = Gia_ManConst0Lit();  
-    probes_free(ms, cMem->cByte[i].valueProbes, cMem->cByte[i].value->size);
-    cMem->cByte[i].valueProbes = NULL;
-    vec_release(ms, cMem->cByte[i].value);
-    cMem->cByte[i].value = NULL;
-  }
-  free(cMem->cByte);
+  uintmax_t p;
+  if(ms->concrete_only) {
+    free(cMem->bytes);
+    free(cMem->written);
+    free(cMem);
+    return;
+  }
+  for(p = 0; p < cMem->num_pages; p++)
+    if(cMem->pages[p] != NULL)
+      cMemory_page_release(ms, cMem->pages[p]);
+  cMemory_clean(ms, cMem);
+  free(cMem->pages);
+  free(cMem->dirty);
   free(cMem);
 }
 
 void cMemory_print(machine_state *ms, cMemory *cMem, uint8_t full) {
   uintmax_t i;
   fprintf(stdout, "cMemory(%p): base_address=0x%jx, size=%ju\n", cMem, cMem->base_address, cMem->size);
+  if(ms->concrete_only) {
+    for(i = 0; i < cMem->size; i++) {
+      if(cMem->written[i]) fprintf(stdout, "%02x", cMem->bytes[i]);
+      else fprintf(stdout, "..");
+      fprintf(stdout, " ");
+      if(i%32 == 31) fprintf(stdout, "\n");
+    }
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    return;
+  }
   if(full == 1) {
     for(i = 0; i < cMem->size; i++) {
-      if(cMem->cByte[i].writtenTo == Gia_ManConst0Lit()) continue;
-      fprintf(stdout, "0x%jx (%p) ", i, cMem->cByte[i].value);
+      cMemoryCell *cell = cMemory_findCell(cMem, i);
+      if(cell == NULL || cell->writtenTo == Gia_ManConst0Lit()) continue;
+      Vector *byte = cMemory_page_get(ms, cMem->pages[CMEM_PAGE(i)], CMEM_PAGE_OFFSET(i));
+      fprintf(stdout, "0x%jx (%p) ", i, cell->value);
       fprintf(stdout, "writtenTo=");
-      Gia_ObjPrint(ms->ntk, Gia_ObjFromLit(ms->ntk, cMem->cByte[i].writtenTo));
-      vec_print(ms, cMem->cByte[i].value);
+      Gia_ObjPrint(ms->ntk, Gia_ObjFromLit(ms->ntk, cell->writtenTo));
+      vec_print(ms, byte);
+      vec_release(ms, byte);
     }
   } else if(full == 0) {
     for(i = 0; i < cMem->size; i++) {
-      if(cMem->cByte[i].writtenTo == Gia_ManConst0Lit()) {
+      cMemoryCell *cell = cMemory_findCell(cMem, i);
+      if(cell == NULL || cell->writtenTo == Gia_ManConst0Lit()) {
 	fprintf(stdout, "..");
+      } else if(cell->value == NULL) {
+	fprintf(stdout, "%02x", cMem->pages[CMEM_PAGE(i)]->bytes[CMEM_PAGE_OFFSET(i)]);
       } else {
-	vec_printSimple(ms, cMem->cByte[i].value);
+	vec_printSimple(ms, cell->value);
       }
       fprintf(stdout, " ");
       if(i%32 == 31) fprintf(stdout, "\n");
@@ -73,11 +221,28 @@ void cMemory_store_le(machine_state *ms, uintmax_t address, Vector *value, uintm
     exit(0);
   }
 
-  Vector **vec_split = vec_splitIntoNewArray(ms, value, size);
-  for(i = 0; i < size; i++) {
-    vec_copy(ms, cMem->cByte[(address - cMem->base_address) + i].value, vec_split[i]);
-    cMem->cByte[(address - cMem->base_address) + i].writtenTo = Gia_ManConst1Lit();
+  if(ms->concrete_only) {
+    //A private copy, so the caller's vector keeps its term or literals
+    Vector *con = vec_dup(ms, value);
+    vec_force(ms, con);
+    if(con->isSymbolic) vec_sym_to_con(ms, con); //Only constant literals exist
+    for(i = 0; i < size; i++) {
+      cMem->bytes[(address - cMem->base_address) + i] = (uint8_t)vec_con_getbits(con, (i)*BITS_IN_BYTE, BITS_IN_BYTE);
+      cMem->written[(address - cMem->base_address) + i] = 1;
+    }
+    vec_release(ms, con);
+    return;
+  }
+
+  if(value->term == 0 && !value->isSymbolic) {
+    for(i = 0; i < size; i++)
+      cMemory_storeConByte(ms, cMem, (address - cMem->base_address) + i, (uint8_t)vec_con_getbits(value, (i)*BITS_IN_BYTE, BITS_IN_BYTE));
+    return;
   }
+
+  Vector **vec_split = vec_splitIntoNewArray(ms, value, size);
+  for(i = 0; i < size; i++)
+    cMemory_storeByte(ms, cMem, (address - cMem->base_address) + i, vec_split[i]);
   vec_releaseArray(ms, vec_split, size);
 }
 
@@ -95,14 +260,62 @@ void cMemory_store_be(machine_state *ms, uintmax_t address, Vector *value, uintm
     exit(0);
   }
 
-  Vector **vec_split = vec_splitIntoNewArray(ms, value, size);
-  for(i = 0; i < size; i++) {
-    vec_copy(ms, cMem->cByte[(address - cMem->base_address) + i].value, vec_split[(size-1)-i]);
-    cMem->cByte[(address - cMem->base_address) + i].writtenTo = Gia_ManConst1Lit();
+  if(ms->concrete_only) {
+    //A private copy, so the caller's vector keeps its term or literals
+    Vector *con = vec_dup(ms, value);
+    vec_force(ms, con);
+    if(con->isSymbolic) vec_sym_to_con(ms, con); //Only constant literals exist
+    for(i = 0; i < size; i++) {
+      cMem->bytes[(address - cMem->base_address) + i] = (uint8_t)vec_con_getbits(con, ((size-1)-i)*BITS_IN_BYTE, BITS_IN_BYTE);
+      cMem->written[(address - cMem->base_address) + i] = 1;
+    }
+    vec_release(ms, con);
+    return;
+  }
+
+  if(value->term == 0 && !value->isSymbolic) {
+    for(i = 0; i < size; i++)
+      cMemory_storeConByte(ms, cMem, (address - cMem->base_address) + i, (uint8_t)vec_con_getbits(value, ((size-1)-i)*BITS_IN_BYTE, BITS_IN_BYTE));
+    return;
   }
+
+  Vector **vec_split = vec_splitIntoNewArray(ms, value, size);
+  for(i = 0; i < size; i++)
+    cMemory_storeByte(ms, cMem, (address - cMem->base_address) + i, vec_split[(size-1)-i]);
   vec_releaseArray(ms, vec_split, size);
 }
 
+//Copy the byte at 'offset' from the base address into 'vec', reporting a
+//read of a byte that was never written
+void cMemory_loadByte(machine_state *ms, cMemory *cMem, uintmax_t offset, Vector *vec) {
+  cMemoryCell *cell = cMemory_findCell(cMem, offset);
+  if(cell == NULL || cell->writtenTo == Gia_ManConst0Lit()) {
+    fprintf(stdout, "Error: cMemory Read-Before-Write error at address 0x%jx (assuming [0x%jx] = 0)\n", offset, offset);
+  }
+  if(cell == NULL) vec_setValue(ms, vec, 0);
+  else if(cell->value == NULL) vec_setValue(ms, vec, cMem->pages[CMEM_PAGE(offset)]->bytes[CMEM_PAGE_OFFSET(offset)]);
+  else vec_copy(ms, vec, cell->value);
+}
+
+//The 'size' bytes at 'offset' from the base address as a little endian
+//word, if they fit one, are on one page and are all written and concrete.
+//Otherwise 0, and the caller goes byte by byte.
+uint8_t cMemory_loadConWord(cMemory *cMem, uintmax_t offset, uintmax_t size, uintmax_t *word) {
+  uintmax_t i, k = CMEM_PAGE_OFFSET(offset);
+  cMemoryPage *page = cMem->pages[CMEM_PAGE(offset)];
+  if(size == 0 || size*BITS_IN_BYTE > WORD_BITS || k+size > CMEM_PAGE_SIZE || page == NULL) return 0;
+  for(i = k; i < k+size; i++)
+    if(page->cByte[i].value != NULL || page->cByte[i].writtenTo != Gia_ManConst1Lit()) return 0;
+  *word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  memcpy(word, &page->bytes[k], size);
+#else
+  for(i = 0; i < size; i++)
+    *word |= ((uintmax_t)page->bytes[k+i]) << (i*BITS_IN_BYTE);
+#endif
+  return 1;
+}
+
 //Load 'size' bytes from 'cMem' at address 'address' into ret (little endian)
 Vector *cMemory_load_le(machine_state *ms, uintmax_t address, uintmax_t size) {
   uintmax_t i;
@@ -115,13 +328,24 @@ Vector *cMemory_load_le(machine_state *ms, uintmax_t address, uintmax_t size) {
     exit(0);
   }
 
-  Vector **vec_split = vec_getArray(ms, size, BITS_IN_BYTE);
-  for(i = 0; i < size; i++) {
-    if(cMem->cByte[(address - cMem->base_address) + i].writtenTo == Gia_ManConst0Lit()) {
-      fprintf(stdout, "Error: cMemory Read-Before-Write error at address 0x%jx (assuming [0x%jx] = 0)\n", (address - cMem->base_address)+i, (address - cMem->base_address)+i);
+  if(ms->concrete_only) {
+    Vector *ret = vec_getConstant(ms, 0, size*BITS_IN_BYTE);
+    for(i = 0; i < size; i++) {
+      if(!cMem->written[(address - cMem->base_address) + i]) {
+	fprintf(stdout, "Error: cMemory Read-Before-Write error at address 0x%jx (assuming [0x%jx] = 0)\n", (address - cMem->base_address)+i, (address - cMem->base_address)+i);
+      }
+      vec_con_setbits(ret, (i)*BITS_IN_BYTE, BITS_IN_BYTE, cMem->bytes[(address - cMem->base_address) + i]);
     }
-    vec_copy(ms, vec_split[i], cMem->cByte[(address - cMem->base_address) + i].value);
+    return ret;
   }
+
+  uintmax_t word;
+  if(cMemory_loadConWord(cMem, address - cMem->base_address, size, &word))
+    return vec_getConstant(ms, word, size*BITS_IN_BYTE);
+
+  Vector **vec_split = vec_getArray(ms, size, BITS_IN_BYTE);
+  for(i = 0; i < size; i++)
+    cMemory_loadByte(ms, cMem, (address - cMem->base_address) + i, vec_split[i]);
   Vector *ret = vec_joinArray(ms, vec_split, size);
   vec_releaseArray(ms, vec_split, size);
 
@@ -140,13 +364,27 @@ Vector *cMemory_load_be(machine_state *ms, uintmax_t address, uintmax_t size) {
     exit(0);
   }
   
-  Vector **vec_split = vec_getArray(ms, size, BITS_IN_BYTE);
-  for(i = 0; i < size; i++) {
-    if(cMem->cByte[(address - cMem->base_address) + i].writtenTo == Gia_ManConst0Lit()) {
-      fprintf(stdout, "Error: cMemory Read-Before-Write error at address 0x%jx (assuming [0x%jx] = 0)\n", (address - cMem->base_address)+i, (address - cMem->base_address)+i);
+  if(ms->concrete_only) {
+    Vector *ret = vec_getConstant(ms, 0, size*BITS_IN_BYTE);
+    for(i = 0; i < size; i++) {
+      if(!cMem->written[(address - cMem->base_address) + i]) {
+	fprintf(stdout, "Error: cMemory Read-Before-Write error at address 0x%jx (assuming [0x%jx] = 0)\n", (address - cMem->base_address)+i, (address - cMem->base_address)+i);
+      }
+      vec_con_setbits(ret, ((size-1)-i)*BITS_IN_BYTE, BITS_IN_BYTE, cMem->bytes[(address - cMem->base_address) + i]);
     }
-    vec_copy(ms, vec_split[(size-1)-i], cMem->cByte[(address - cMem->base_address) + i].value);
+    return ret;
   }
+
+  uintmax_t word, swapped = 0;
+  if(cMemory_loadConWord(cMem, address - cMem->base_address, size, &word)) {
+    for(i = 0; i < size; i++, word >>= BITS_IN_BYTE)
+      swapped = (swapped << BITS_IN_BYTE) | (word & 0xff);
+    return vec_getConstant(ms, swapped, size*BITS_IN_BYTE);
+  }
+
+  Vector **vec_split = vec_getArray(ms, size, BITS_IN_BYTE);
+  for(i = 0; i < size; i++)
+    cMemory_loadByte(ms, cMem, (address - cMem->base_address) + i, vec_split[(size-1)-i]);
   Vector *ret = vec_joinArray(ms, vec_split, size);
   vec_releaseArray(ms, vec_split, size);
   return ret;
@@ -168,8 +406,15 @@ Gia_Lit_t cMemory_load_rbw(machine_state *ms, uintmax_t address, uintmax_t size)
   Gia_Lit_t rbw = Gia_ManConst0Lit();
   k = address - cMem->base_address;
   j = k+size;
+  if(ms->concrete_only) {
+    for(; k < j; k++)
+      if(!cMem->written[k]) return Gia_ManConst1Lit();
+    return rbw;
+  }
   for(; k < j; k++) {
-    rbw = Gia_ManHashOr(ms->ntk, rbw, Abc_LitNot(cMem->cByte[k].writtenTo));
+    cMemoryCell *cell = cMemory_findCell(cMem, k);
+    if(cell == NULL) return Gia_ManConst1Lit();
+    rbw = Gia_ManHashOr(ms->ntk, rbw, Abc_LitNot(cell->writtenTo));
     if(rbw == Gia_ManConst1Lit()) break;
   }
   
@@ -179,7 +424,7 @@ Gia_Lit_t cMemory_load_rbw(machine_state *ms, uintmax_t address, uintmax_t size)
 //Merge cMemT and cMemF. Normally used after returning from a conditional.
 //The cMemory not returned will be free'd.
 cMemory *cMemory_ite(machine_state *ms, Gia_Lit_t c, cMemory *cMemT, cMemory *cMemF) {
-  uintmax_t k;
+  uintmax_t k, p, w;
   assert(cMemT->size == cMemF->size);
   assert(cMemT->base_address == cMemF->base_address);
   if(Gia_ManIsConstLit(c)) {
@@ -192,22 +437,64 @@ cMemory *cMemory_ite(machine_state *ms, Gia_Lit_t c, cMemory *cMemT, cMemory *cM
       return cMemT;
     }
   }
+  assert(!ms->concrete_only);
   
-  for(k = 0; k < cMemT->size; k++) {
-    Vector *TByte = cMemT->cByte[k].value;
-    Vector *FByte = cMemF->cByte[k].value;
+  for(p = 0; p < cMemT->num_pages; p++) {
+    cMemoryPage *TPage = cMemT->pages[p];
+    cMemoryPage *FPage = cMemF->pages[p];
+    uint64_t *TDirty = cMemT->dirty[p];
+    uint64_t *FDirty = cMemF->dirty[p];
     
-    if(Gia_ManIsConst0Lit(cMemF->cByte[k].writtenTo)) {
-      //keep TByte, ignore FByte
-    } else if(Gia_ManIsConst0Lit(cMemT->cByte[k].writtenTo)) {
-      //keep FByte, ignore TByte
-      vec_copy(ms, TByte, FByte);
-      cMemT->cByte[k].writtenTo = cMemF->cByte[k].writtenTo;
+    if(TDirty == NULL && FDirty == NULL) {
+      //Not stored to on either side
+      continue;
+    } else if(FPage == NULL || FPage == TPage) {
+      //Nothing written on the false side, or the same page on both; keep TPage
+    } else if(TPage == NULL) {
+      //Nothing written on the true side, take FPage over
+      cMemT->pages[p] = FPage;
+      cMemF->pages[p] = NULL;
     } else {
-      Vector *ITEByte = vec_ite(ms, c, TByte, FByte);
-      vec_copy(ms, TByte, ITEByte);
-      vec_release(ms, ITEByte);
-      cMemT->cByte[k].writtenTo = Gia_ManHashMux(ms->ntk, c, cMemT->cByte[k].writtenTo, cMemF->cByte[k].writtenTo);
+      TPage = cMemT->pages[p] = cMemory_page_unshare(ms, TPage);
+      
+      for(w = 0; w < CMEM_DIRTY_WORDS; w++) {
+	uint64_t bits = ((TDirty != NULL) ? TDirty[w] : 0) | ((FDirty != NULL) ? FDirty[w] : 0);
+	for(; bits != 0; bits &= bits-1) {
+	  k = w*64 + int_lsb_index(bits);
+	  cMemoryCell *TCell = &TPage->cByte[k];
+	  cMemoryCell *FCell = &FPage->cByte[k];
+	  
+	  if(Gia_ManIsConst0Lit(FCell->writtenTo)) {
+	    //keep TByte, ignore FByte
+	  } else if(Gia_ManIsConst0Lit(TCell->writtenTo)) {
+	    //keep FByte, ignore TByte
+	    if(FCell->value == NULL) cMemory_page_setCon(ms, TPage, k, FPage->bytes[k]);
+	    else cMemory_page_set(ms, TPage, k, FCell->value);
+	    TCell->writtenTo = FCell->writtenTo;
+	  } else if(TCell->value == NULL && FCell->value == NULL && TPage->bytes[k] == FPage->bytes[k]) {
+	    //The same concrete byte on both sides
+	    TCell->writtenTo = Gia_ManHashMux(ms->ntk, c, TCell->writtenTo, FCell->writtenTo);
+	  } else {
+	    Vector *TByte = cMemory_page_get(ms, TPage, k);
+	    Vector *FByte = cMemory_page_get(ms, FPage, k);
+	    Vector *ITEByte = vec_ite(ms, c, TByte, FByte);
+	    cMemory_page_set(ms, TPage, k, ITEByte);
+	    vec_release(ms, ITEByte);
+	    vec_release(ms, FByte);
+	    vec_release(ms, TByte);
+	    TCell->writtenTo = Gia_ManHashMux(ms->ntk, c, TCell->writtenTo, FCell->writtenTo);
+	  }
+	}
+      }
+    }
+    
+    //The merged page differs from the state before the branch where either side wrote
+    if(TDirty == NULL) {
+      cMemT->dirty[p] = FDirty;
+      cMemF->dirty[p] = NULL;
+    } else if(FDirty != NULL) {
+      for(w = 0; w < CMEM_DIRTY_WORDS; w++)
+	TDirty[w] |= FDirty[w];
     }
   }
   
@@ -215,40 +502,40 @@ cMemory *cMemory_ite(machine_state *ms, Gia_Lit_t c, cMemory *cMemT, cMemory *cM
   return cMemT;
 }
 
+//A copy of 'cMem' sharing all of its pages, and its dirty bytes
 cMemory *cMemory_copy(machine_state *ms, cMemory *cMem) {
-  uintmax_t i;
+  uintmax_t p;
   cMemory *cMemRet = cMemory_init(ms, cMem->base_address, cMem->size);
-  for(i = 0; i < cMem->size; i++) {
-    vec_copy(ms, cMemRet->cByte[i].value, cMem->cByte[i].value);
-    cMemRet->cByte[i].writtenTo = cMem->cByte[i].writtenTo;
-  }
-  return cMemRet;
-}
-
-void cMemory_update_probes(machine_state *ms, cMemory *cMem) {
-  uintmax_t i;
-  for(i = 0; i < cMem->size; i++) {
-    if(cMem->cByte[i].writtenTo != Gia_ManConst0Lit())
-      update_probes_from_vec(ms, cMem->cByte[i].valueProbes, cMem->cByte[i].value);
-    update_probe_from_lit(ms, cMem->cByte[i].writtenToProbe, cMem->cByte[i].writtenTo);
+  if(ms->concrete_only) {
+    memcpy(cMemRet->bytes, cMem->bytes, cMem->size);
+    memcpy(cMemRet->written, cMem->written, cMem->size);
+    return cMemRet;
   }
-}
-
-void cMemory_update_from_probes(machine_state *ms, cMemory *cMem) {
-  uintmax_t i;
-  for(i = 0; i < cMem->size; i++) {
-    if(cMem->cByte[i].writtenTo != Gia_ManConst0Lit())
-      update_vec_from_probes(ms, cMem->cByte[i].valueProbes, cMem->cByte[i].value);
-    cMem->cByte[i].writtenTo = get_lit_from_probe(ms, cMem->cByte[i].writtenToProbe);
+  for(p = 0; p < cMem->num_pages; p++) {
+    cMemRet->pages[p] = cMem->pages[p];
+    if(cMem->pages[p] != NULL) cMem->pages[p]->refs++;
+    if(cMem->dirty[p] != NULL) {
+      cMemRet->dirty[p] = (uint64_t *)malloc(CMEM_DIRTY_WORDS * sizeof(uint64_t));
+      memcpy(cMemRet->dirty[p], cMem->dirty[p], CMEM_DIRTY_WORDS * sizeof(uint64_t));
+    }
   }
+  return cMemRet;
 }
 
-void cMemory_collect_probes(machine_state *ms, cMemory *cMem) {
-  uintmax_t i;
-  for(i = 0; i < cMem->size; i++) {
-    if(cMem->cByte[i].writtenTo != Gia_ManConst0Lit())
-      collect_probes(ms, cMem->cByte[i].valueProbes, cMem->cByte[i].value->size);
-    collect_probe(ms, cMem->cByte[i].writtenToProbe);
+//Register the symbolic bytes of 'cMem' as garbage collection roots. A
+//page shared with a memory already walked under this CurrsMemFlag is
+//skipped.
+void cMemory_gc_roots(machine_state *ms, cMemory *cMem, uint8_t collect) {
+  uintmax_t i, p;
+  if(ms->concrete_only) return;
+  for(p = 0; p < cMem->num_pages; p++) {
+    cMemoryPage *page = cMem->pages[p];
+    if(page == NULL || page->flag == ms->CurrsMemFlag) continue;
+    page->flag = ms->CurrsMemFlag;
+    for(i = 0; i < CMEM_PAGE_SIZE; i++) {
+      if(page->cByte[i].value != NULL) gc_root_vec(ms, page->cByte[i].value, collect);
+      gc_root_lit(ms, &page->cByte[i].writtenTo, collect);
+    }
   }
 }
 
@@ -257,16 +544,13 @@ void cMemory_collect_probes(machine_state *ms, cMemory *cMem) {
 sMemory *sMemory_init(machine_state *ms, uint8_t address_size) {
   sMemory *sMem = (sMemory *)malloc(1 * sizeof(sMemory));
   sMem->memoized_flag = 0;
-  sMem->memoized_value = vec_getConstant(ms, 0, BITS_IN_BYTE);
-  sMem->memoized_value_probes = get_probes_from_vec(ms, sMem->memoized_value);
+  sMem->memoized_value = vec_scope_keep(ms, vec_getConstant(ms, 0, BITS_IN_BYTE));
   sMem->writtenTo = Gia_ManConst0Lit();
-  sMem->writtenToProbe = get_probe_from_lit(ms, sMem->writtenTo);
   sMem->head = 0;
   sMem->size = SYMBOLIC_MEMORY_SIZE;
   sMem->address_size = address_size;
   sMem->sByteArray = (sMemoryCell *)malloc(sMem->size * sizeof(sMemoryCell));
   sMem->c = Gia_ManConst1Lit();
-  sMem->cProbe = get_probe_from_lit(ms, sMem->c);
   sMem->sMemT = NULL;
   sMem->sMemF = NULL;
   arr_stack_push(ms->sMemInitStack, (void *)sMem);
@@ -317,20 +601,13 @@ void sMemory_free(machine_state *ms, sMemory *sMem) {
     assert(sMem_tmp->sByteArray != NULL);
 
     for(i = 0; i < sMem_tmp->head; i++) {
-      probes_free(ms, sMem_tmp->sByteArray[i].addressProbes, sMem_tmp->sByteArray[i].address->size);
       vec_release(ms, sMem_tmp->sByteArray[i].address);
-      probes_free(ms, sMem_tmp->sByteArray[i].valueProbes, sMem_tmp->sByteArray[i].value->size);
       vec_release(ms, sMem_tmp->sByteArray[i].value);      
     }
     free(sMem_tmp->sByteArray);
     sMem_tmp->sByteArray = NULL;
 
-    probe_free(ms, sMem_tmp->writtenToProbe);
-    
-    probes_free(ms, sMem_tmp->memoized_value_probes, sMem_tmp->memoized_value->size);
     vec_release(ms, sMem_tmp->memoized_value);
-
-    probe_free(ms, sMem_tmp->cProbe);
         
     free(sMem_tmp);
   }
@@ -413,12 +690,8 @@ uint8_t sMemory_removeByte(machine_state *ms, Vector *address) {
   
   for(i = sMem->head-1; i >= 0; i--) {
     if(vec_sym_equal(ms, address, sMem->sByteArray[i].address)==1) {
-      probes_free(ms, sMem->sByteArray[i].addressProbes, sMem->sByteArray[i].address->size);
-      sMem->sByteArray[i].addressProbes = NULL;
       vec_release(ms, sMem->sByteArray[i].address);
       sMem->sByteArray[i].address = NULL;
-      probes_free(ms, sMem->sByteArray[i].valueProbes, sMem->sByteArray[i].value->size);
-      sMem->sByteArray[i].valueProbes = NULL;
       vec_release(ms, sMem->sByteArray[i].value);
       sMem->sByteArray[i].value = NULL;
       break;
@@ -450,10 +723,8 @@ void sMemory_storeByte(machine_state *ms, Vector *address, Vector *value) {
   
   if(sMem->head >= (sMem->size - 2)) //Check for out of memory
     sMemory_increaseSize(sMem);
-  sMem->sByteArray[sMem->head].address = address;
-  sMem->sByteArray[sMem->head].value = value;
-  sMem->sByteArray[sMem->head].addressProbes = get_probes_from_vec(ms, address);
-  sMem->sByteArray[sMem->head].valueProbes = get_probes_from_vec(ms, value);
+  sMem->sByteArray[sMem->head].address = vec_scope_keep(ms, address);
+  sMem->sByteArray[sMem->head].value = vec_scope_keep(ms, value);
   sMem->head++;
 }
 
@@ -684,7 +955,7 @@ Vector *sMemory_load_le(machine_state *ms, Vector *address, uintmax_t size) {
   
   Vector *vec_one = vec_getConstant(ms, 1, address->size);
   
-  uint8_t isSymbolic = ((size*BITS_IN_BYTE) > WORD_BITS);
+  uint8_t isSymbolic = 0;
   for(i = 0; i < size; i++) {
     ms->CurrsMemFlag++;
     ret = sMemory_loadByte(ms, sMem, address_i);
@@ -717,12 +988,11 @@ Vector *sMemory_load_le(machine_state *ms, Vector *address, uintmax_t size) {
   
   if(!isSymbolic) {
     //Concrete case
-    for(i = 0; i < size; i++) {
+    for(k = size-1; k >= 0; k--) {
       Vector *vec_byte = (Vector *)arr_stack_pop(ms->sMemStack);
       assert(vec_byte->size == BITS_IN_BYTE);
       assert(!vec_byte->isSymbolic);
-      ret->conWord <<= BITS_IN_BYTE;
-      ret->conWord |= vec_byte->conWord & (((uintmax_t) ~0)>>(WORD_BITS - BITS_IN_BYTE)); //0xFF when BITS_IN_BYTE == 8
+      vec_con_setbits(ret, k*BITS_IN_BYTE, BITS_IN_BYTE, vec_byte->conWord);
       vec_release(ms, vec_byte); //release the pushed vectors
     }
     ret->isSymbolic = 0;      
@@ -730,6 +1000,7 @@ Vector *sMemory_load_le(machine_state *ms, Vector *address, uintmax_t size) {
     //Symbolic case
     for(k = size-1; k >= 0; k--) {
       Vector *vec_byte = (Vector *)arr_stack_pop(ms->sMemStack);
+      vec_force(ms, vec_byte);
       if(!vec_byte->isSymbolic) vec_calc_sym(ms, vec_byte);
       assert(vec_byte->symWord!=NULL);
       for(i = 0; i < BITS_IN_BYTE; i++) {
@@ -765,7 +1036,7 @@ Vector *sMemory_load_be(machine_state *ms, Vector *address, uintmax_t size) {
   
   Vector *vec_one = vec_getConstant(ms, 1, address->size);
   
-  uint8_t isSymbolic = ((size*BITS_IN_BYTE) > WORD_BITS);
+  uint8_t isSymbolic = 0;
   for(i = 0; i < size; i++) {
     ms->CurrsMemFlag++;
     ret = sMemory_loadByte(ms, sMem, address_i);
@@ -798,12 +1069,11 @@ Vector *sMemory_load_be(machine_state *ms, Vector *address, uintmax_t size) {
   
   if(!isSymbolic) {
     //Concrete case
-    for(i = 0; i < size; i++) {
+    for(k = size-1; k >= 0; k--) {
       Vector *vec_byte = (Vector *)arr_stack_pop(ms->sMemStack);
       assert(vec_byte->size == BITS_IN_BYTE);
       assert(!vec_byte->isSymbolic);
-      ret->conWord <<= BITS_IN_BYTE;
-      ret->conWord |= vec_byte->conWord & (((uintmax_t) ~0)>>(WORD_BITS - BITS_IN_BYTE)); //0xFF when BITS_IN_BYTE == 8
+      vec_con_setbits(ret, k*BITS_IN_BYTE, BITS_IN_BYTE, vec_byte->conWord);
       vec_release(ms, vec_byte); //release the pushed vectors
     }
     ret->isSymbolic = 0;      
@@ -811,6 +1081,7 @@ Vector *sMemory_load_be(machine_state *ms, Vector *address, uintmax_t size) {
     //Symbolic case
     for(k = size-1; k >= 0; k--) {
       Vector *vec_byte = (Vector *)arr_stack_pop(ms->sMemStack);
+      vec_force(ms, vec_byte);
       if(!vec_byte->isSymbolic) vec_calc_sym(ms, vec_byte);
 	assert(vec_byte->symWord!=NULL);
       for(i = 0; i < BITS_IN_BYTE; i++) {
@@ -928,12 +1199,8 @@ uintmax_t _sMemory_compress(machine_state *ms, sMemory *sMem) {
       if(sMem->sByteArray[i].address == NULL || sMem->sByteArray[j].address == NULL) {
 	continue;
       } else if(vec_sym_equal(ms, sMem->sByteArray[i].address, sMem->sByteArray[j].address)==1) {
-	probes_free(ms, sMem->sByteArray[j].addressProbes, sMem->sByteArray[j].address->size);
-	sMem->sByteArray[j].addressProbes = NULL;
 	vec_release(ms, sMem->sByteArray[j].address);
 	sMem->sByteArray[j].address = NULL;
-	probes_free(ms, sMem->sByteArray[j].valueProbes, sMem->sByteArray[j].value->size);
-	sMem->sByteArray[j].valueProbes = NULL;
 	vec_release(ms, sMem->sByteArray[j].value);
 	sMem->sByteArray[j].value = NULL;
       }
@@ -962,45 +1229,21 @@ void sMemory_compress(machine_state *ms, sMemory *sMem) {
   sMemory_check(ms, sMem);   
 }
 
-void sMemory_update_probes(machine_state *ms, sMemory *sMem) {   
+//Register 'sMem' and the memories it reads through as garbage collection
+//roots; only the probes of 'sMem' itself are collected
+void sMemory_gc_roots(machine_state *ms, sMemory *sMem, uint8_t collect) {
   uintmax_t i;
-  
+
   if(sMem == NULL) return;
   if(sMem->memoized_flag == ms->CurrsMemFlag) return;
   sMem->memoized_flag = ms->CurrsMemFlag;
-  sMemory_update_probes(ms, sMem->sMemT);
-  sMemory_update_probes(ms, sMem->sMemF);
-  update_probes_from_vec(ms, sMem->memoized_value_probes, sMem->memoized_value);
-  update_probe_from_lit(ms, sMem->writtenToProbe, sMem->writtenTo);
-  for(i = 0; i < sMem->head; i++) {
-    update_probes_from_vec(ms, sMem->sByteArray[i].addressProbes, sMem->sByteArray[i].address);
-    update_probes_from_vec(ms, sMem->sByteArray[i].valueProbes, sMem->sByteArray[i].value);
-  }
-  update_probe_from_lit(ms, sMem->cProbe, sMem->c);
-}
-
-void sMemory_update_from_probes(machine_state *ms, sMemory *sMem) {   
-  uintmax_t i;
-
-  if(sMem == NULL) return;
-  update_vec_from_probes(ms, sMem->memoized_value_probes, sMem->memoized_value);
-  sMem->writtenTo = get_lit_from_probe(ms, sMem->writtenToProbe);
-  for(i = 0; i < sMem->head; i++) {
-    update_vec_from_probes(ms, sMem->sByteArray[i].addressProbes, sMem->sByteArray[i].address);
-    update_vec_from_probes(ms, sMem->sByteArray[i].valueProbes, sMem->sByteArray[i].value);
-  }
-  sMem->c = get_lit_from_probe(ms, sMem->cProbe);
-}
-
-void sMemory_collect_probes(machine_state *ms, sMemory *sMem) {
-  uintmax_t i = 0;
-
-  if(sMem == NULL) return;
-  collect_probes(ms, sMem->memoized_value_probes, sMem->memoized_value->size);
-  collect_probe(ms, sMem->writtenToProbe);
+  sMemory_gc_roots(ms, sMem->sMemT, 0);
+  sMemory_gc_roots(ms, sMem->sMemF, 0);
+  gc_root_vec(ms, sMem->memoized_value, collect);
+  gc_root_lit(ms, &sMem->writtenTo, collect);
   for(i = 0; i < sMem->head; i++) {
-    collect_probes(ms, sMem->sByteArray[i].addressProbes, sMem->sByteArray[i].address->size);
-    collect_probes(ms, sMem->sByteArray[i].valueProbes, sMem->sByteArray[i].value->size);
+    gc_root_vec(ms, sMem->sByteArray[i].address, collect);
+    gc_root_vec(ms, sMem->sByteArray[i].value, collect);
   }
-  collect_probe(ms, sMem->cProbe);
+  gc_root_lit(ms, &sMem->c, collect);
 }
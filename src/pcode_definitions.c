@@ -5,8 +5,8 @@ uint32_t random_seed = 0;
 
 //address_size is the number of bits needed to represent an address, i.e. 32, 64.
 machine_state *machine_state_init(char *network_name, uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size) {
-  uintmax_t i;
   machine_state *ms = malloc(sizeof(*ms));
+  ms->concrete_only = 0;
 
   if(abc_started == 0) {
     ms->ntk = Gia_SweeperStart(NULL);
@@ -29,22 +29,62 @@ machine_state *machine_state_init(char *network_name, uintmax_t cmem_base_addres
   }
   abc_started++;
   ms->ntk->pName = Abc_UtilStrsav(network_name);
-  
+
+  return machine_state_init_stacks(ms, cmem_base_address, cmem_size, ho, address_size);
+}
+
+//A machine state for runs where every input is concrete (e.g. replaying
+//test inputs). There is no sweeper, no probes are made, and cMemory is a
+//plain byte array. The AIG manager only ever holds the constant node; it
+//is there so the kernels' folding of constant literals keeps working.
+machine_state *machine_state_init_concrete(uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size) {
+  machine_state *ms = malloc(sizeof(*ms));
+  ms->concrete_only = 1;
+  ms->ntk = Gia_ManStart(1);
+  ms->pOutputProbes = Vec_IntAlloc(0);
+  ms->pOutputNames = Vec_PtrAlloc(0);
+  ms->gc_probes = Vec_IntAlloc(0);
+
+  return machine_state_init_stacks(ms, cmem_base_address, cmem_size, ho, address_size);
+}
+
+machine_state *machine_state_init_stacks(machine_state *ms, uintmax_t cmem_base_address, uintmax_t cmem_size, uintmax_t ho, uint8_t address_size) {
+  uintmax_t i;
+
   //Initialize the vector stack
   fprintf(stdout, "Initializing Stacks\n");
   ms->vecs_allocated = 0;
   ms->vecs_in_stack = 0;
   ms->vectorStack_size = 64; //Start w/ a stack of vectors of size 1..64 bits
   ms->vectorStack = (void_arr_stack **)malloc(ms->vectorStack_size * sizeof(void_arr_stack *));
+  ms->vecPrefill = (uintmax_t *)calloc(ms->vectorStack_size, sizeof(uintmax_t));
   for(i = 0; i < ms->vectorStack_size; i++)
     ms->vectorStack[i] = arr_stack_init();
+  ms->vec_pool_budget = VEC_POOL_BUDGET;
+  vec_slabs_init(ms);
+#ifdef VEC_POOL_STATS
+  vec_pool_stats_init(ms);
+#endif
+  ms->vec_cow = 0;
+  ms->vec_adder = VEC_ADDER_RIPPLE;
+  ms->vec_multiplier = VEC_MULT_ARRAY;
+  ms->vec_memo = 1;
+  ms->vecMemo = NULL;
+  ms->vecCmpLast.lits = NULL;
+  ms->vec_memo_hits = 0;
+  ms->vec_memo_misses = 0;
+  ms->vec_memo_flushes = 0;
+  vec_term_init(ms);
+  vec_rewrite_init(ms);
+  ms->vecScope = arr_stack_init();
+  ms->vecScopeMarks = arr_stack_init();
  
   ms->vec_zero_byte = vec_get(ms, BITS_IN_BYTE);
   ms->vec_zero_byte->conWord = 0;
   ms->vec_zero_byte->isSymbolic = 0;
-  ms->vec_zero_byte_probes = get_probes_from_vec(ms, ms->vec_zero_byte);
 
   ms->conditions_stack = arr_stack_init();
+  gc_roots_init(ms);
  
   ms->nNodes_last = 1000;
   ms->nNodes_increment = 1000;
@@ -53,7 +93,6 @@ machine_state *machine_state_init(char *network_name, uintmax_t cmem_base_addres
   ms->stackframe_depth = 20;
 
   ms->heap_offset = vec_getConstant(ms, ho, address_size);
-  ms->heap_offset_probes = get_probes_from_vec(ms, ms->heap_offset);
 
   ms->CurrsMemFlag = 0;
   ms->sMemStack = arr_stack_init();
@@ -89,20 +128,29 @@ void machine_state_free(machine_state *ms) {
     fprintf(stderr, "Warning: %ju sMemories still in delete stack\n", ms->sMemDeleteStack->head);
   arr_stack_free(ms->sMemDeleteStack);
 
-  probes_free(ms, ms->heap_offset_probes, ms->heap_offset->size);
   vec_release(ms, ms->heap_offset);
 
   if(ms->conditions_stack->head != 0)
     fprintf(stderr, "Warning: %ju conditions sill in conditions stack\n", ms->conditions_stack->head);
   arr_stack_free(ms->conditions_stack);
 
-  probes_free(ms, ms->vec_zero_byte_probes, ms->vec_zero_byte->size);
   vec_release(ms, ms->vec_zero_byte);
   
+  if(ms->vecScopeMarks->head != 0)
+    fprintf(stderr, "Warning: %ju vector scopes still open\n", ms->vecScopeMarks->head);
+  while(ms->vecScopeMarks->head != 0)
+    vec_scope_end(ms);
+  arr_stack_free(ms->vecScopeMarks);
+  arr_stack_free(ms->vecScope);
+
   fprintf(stdout, "Freeing Stacks\n");
   
-  if(ms->vecs_allocated != ms->vecs_in_stack)
+  if(ms->vecs_allocated != ms->vecs_in_stack) {
     fprintf(stderr, "Warning: %ju Vectors were not released\n", ms->vecs_allocated - ms->vecs_in_stack);
+#ifdef VEC_POOL_STATS
+    vec_pool_report_leaks(ms, stderr);
+#endif
+  }
   
   for(i = 0; i < ms->vectorStack_size; i++) {
     while(ms->vectorStack[i]->head!=0)
@@ -110,9 +158,28 @@ void machine_state_free(machine_state *ms) {
     arr_stack_free(ms->vectorStack[i]);
   }
   free(ms->vectorStack);
+  free(ms->vecPrefill);
+  vec_slabs_free(ms);
+  vec_memo_free(ms);
+  vec_offset_free(ms);
+  vec_term_free(ms);
+  gc_roots_free(ms);
+#ifdef VEC_POOL_STATS
+  vec_pool_stats_free(ms);
+#endif
   
   assert(ms->stackframe_depth == 20);
 
+  if(ms->concrete_only) {
+    assert(Gia_ManAndNum(ms->ntk) == 0); //Nothing symbolic was built
+    Vec_IntFree(ms->pOutputProbes);
+    Vec_PtrFree(ms->pOutputNames);
+    Vec_IntFree(ms->gc_probes);
+    Gia_ManStop(ms->ntk);
+    free(ms);
+    return;
+  }
+
   abc_started--;
   if(abc_started == 0) {
     vec_removeLastNOutputs(ms, Vec_IntSize(ms->pOutputProbes));
@@ -161,100 +228,60 @@ Vector *pINT_REM(machine_state *ms, Vector *input0, Vector *input1) {
   return vec_quot_rem(ms, input0, input1, 0);
 }
 
-Vector *pINT_SDIV(machine_state *ms, Vector *input0, Vector *input1) {
+//Both results of an unsigned division from one circuit, for DIV lowerings
+//that need the quotient and the remainder of the same operands
+void pINT_DIVREM(machine_state *ms, Vector *input0, Vector *input1, Vector **quotient, Vector **remainder) {
+  vec_divmod(ms, input0, input1, quotient, remainder);
+}
+
+//Signed counterpart of pINT_DIVREM; either output may be NULL
+void pINT_SDIVREM(machine_state *ms, Vector *input0, Vector *input1, Vector **quotient, Vector **remainder) {
   assert(input0->size == input1->size);
-  Vector *output;
   
   if(!input0->isSymbolic) {
-    if(!input1->isSymbolic) {
+    if(!input1->isSymbolic && input0->size <= WORD_BITS) {
       //Concrete case
-      output = vec_get(ms, input0->size);
       intmax_t input0_se = int_sextend(input0->conWord, input0->size, WORD_BITS);
       intmax_t input1_se = int_sextend(input1->conWord, input1->size, WORD_BITS);
-      if(input1_se == 0) output->conWord = 0;
-      else output->conWord = input0_se / input1_se;
-      output->isSymbolic = 0;
-      return output;
-    } else {
-      vec_calc_sym(ms, input0);
+      if(quotient != NULL) {
+	*quotient = vec_get(ms, input0->size);
+	if(input1_se == 0) (*quotient)->conWord = 0;
+	else (*quotient)->conWord = input0_se / input1_se;
+	(*quotient)->isSymbolic = 0;
+      }
+      if(remainder != NULL) {
+	*remainder = vec_get(ms, input0->size);
+	if(input1_se == 0) (*remainder)->conWord = input0->conWord;
+	else (*remainder)->conWord = input0_se % input1_se;
+	(*remainder)->isSymbolic = 0;
+      }
+      return;
     }
   } else if(!input1->isSymbolic) {
-    if(input1->conWord == 0) {
-      output = vec_getConstant(ms, 0, input0->size);
-      return output;
+    if(vec_con_saturate(input1) == 0) {
+      if(quotient != NULL) *quotient = vec_getConstant(ms, 0, input0->size);
+      if(remainder != NULL) *remainder = vec_getConstant(ms, 0, input0->size);
+      return;
+    }
+    if(input1->size <= WORD_BITS) {
+      vec_sdivmod_const(ms, input0, input1, quotient, remainder);
+      return;
     }
-    vec_calc_sym(ms, input1);
   }
   
   //Symbolic case
-  Vector *vec_zero = vec_getConstant(ms, 0, input0->size);
-  Gia_Lit_t zerotest, sign, sign0, sign1;
-  
-  zerotest = vec_equal(ms, input1, vec_zero);
-  if(Gia_ManIsConst1Lit(zerotest)) return vec_zero;
-  
-  sign0 = input0->symWord[input0->size-1];
-  sign1 = input1->symWord[input1->size-1];
-  sign = Gia_ManHashXor(ms->ntk, sign0, sign1);
-  
-  Vector *input0_abs = vec_abs(ms, input0);
-  Vector *input1_abs = vec_abs(ms, input1);
-  Vector *quotient = vec_quot_rem(ms, input0_abs, input1_abs, 1);
-  Vector *negated = vec_negate(ms, quotient);
-  Vector *intermediate = vec_ite(ms, sign, negated, quotient);
-  output = vec_ite(ms, zerotest, vec_zero, intermediate);
-  
-  vec_release(ms, intermediate);
-  vec_release(ms, negated);
-  vec_release(ms, quotient);
-  vec_release(ms, input1_abs);
-  vec_release(ms, input0_abs);
-  vec_release(ms, vec_zero);
-  
-  return output;   
+  vec_sdivmod(ms, input0, input1, quotient, remainder);
+}
+
+Vector *pINT_SDIV(machine_state *ms, Vector *input0, Vector *input1) {
+  Vector *output;
+  pINT_SDIVREM(ms, input0, input1, &output, NULL);
+  return output;
 }
 
 Vector *pINT_SREM(machine_state *ms, Vector *input0, Vector *input1) {
-  assert(input0->size == input1->size);
   Vector *output;
-  
-  if(!input0->isSymbolic) {
-    if(!input1->isSymbolic) {
-      //Concrete case
-      output = vec_get(ms, input0->size);
-      intmax_t input0_se = int_sextend(input0->conWord, input0->size, WORD_BITS);
-      intmax_t input1_se = int_sextend(input1->conWord, input1->size, WORD_BITS);
-      if(input1_se == 0) output->conWord = input0->conWord;
-      else output->conWord = input0_se % input1_se;
-      output->isSymbolic = 0;
-      return output;
-    } else {
-      vec_calc_sym(ms, input0);
-    }
-  } else if(!input1->isSymbolic) {
-    if(input1->conWord == 0) {
-      output = vec_getConstant(ms, 0, input0->size);
-      return output;
-    }      
-    vec_calc_sym(ms, input1);
-  }
-  
-  //Symbolic case
-  Gia_Lit_t sign = input0->symWord[input0->size-1];
-  
-  Vector *input0_abs = vec_abs(ms, input0);
-  Vector *input1_abs = vec_abs(ms, input1);
-  
-  Vector *temp = vec_quot_rem(ms, input0_abs, input1_abs, 0);
-  Vector *negated = vec_negate(ms, temp);
-  
-  output = vec_ite(ms, sign, negated, temp);
-  
-  vec_release(ms, negated);
-  vec_release(ms, temp);
-  vec_release(ms, input1_abs);
-  vec_release(ms, input0_abs);
-  
+  pINT_SDIVREM(ms, input0, input1, NULL, &output);
   return output;
 }
 
@@ -316,10 +343,14 @@ Vector *pINT_NOTEQUAL(machine_state *ms, Vector *input0, Vector *input1) {
   return output;
 }
 
-Vector *pINT_LESS(machine_state *ms, Vector *input0, Vector *input1) {
+//One flag or ordered predicate (VEC_CMP_*) of input0 against input1, as a
+//byte. Every predicate comes off the fused compare of vec_compare_flags, so
+//the INT_LESS, INT_SLESS, INT_SBORROW and INT_SUB of one CMP share a
+//subtractor.
+Vector *pINT_COMPARE(machine_state *ms, Vector *input0, Vector *input1, uint8_t pred) {
   Vector *output = vec_getConstant(ms, 0, BITS_IN_BYTE);
-  output->symWord[0] = vec_lessthan(ms, input0, input1);
-
+  output->symWord[0] = vec_compare(ms, input0, input1, pred);
+  
   if(Gia_ManIsConstLit(output->symWord[0])) {
     //Concrete case
     if(Gia_ManIsConst1Lit(output->symWord[0])) {
@@ -333,21 +364,12 @@ Vector *pINT_LESS(machine_state *ms, Vector *input0, Vector *input1) {
   return output;
 }
 
+Vector *pINT_LESS(machine_state *ms, Vector *input0, Vector *input1) {
+  return pINT_COMPARE(ms, input0, input1, VEC_CMP_CF);
+}
+
 Vector *pINT_LESSEQUAL(machine_state *ms, Vector *input0, Vector *input1) {
-  Vector *output = vec_getConstant(ms, 0, BITS_IN_BYTE);
-  output->symWord[0] = Abc_LitNot(vec_greaterthan(ms, input0, input1));
-  
-  if(Gia_ManIsConstLit(output->symWord[0])) {
-    //Concrete case
-    if(Gia_ManIsConst1Lit(output->symWord[0])) {
-      output->conWord = 1;
-    }
-  } else {
-    //Symbolic case
-    output->isSymbolic = 1;
-  }
-  
-  return output;
+  return pINT_COMPARE(ms, input0, input1, VEC_CMP_ULE);
 }
 
 Vector *pINT_CARRY(machine_state *ms, Vector *input0, Vector *input1) {
@@ -368,67 +390,22 @@ Vector *pINT_CARRY(machine_state *ms, Vector *input0, Vector *input1) {
 }
 
 Vector *pINT_SLESS(machine_state *ms, Vector *input0, Vector *input1) {
-  Vector *output = vec_getConstant(ms, 0, BITS_IN_BYTE);
-  output->symWord[0] = vec_signed_lessthan(ms, input0, input1);
-  
-  if(Gia_ManIsConstLit(output->symWord[0])) {
-    //Concrete case
-    if(Gia_ManIsConst1Lit(output->symWord[0])) {
-      output->conWord = 1;
-    }
-  } else {
-    //Symbolic case
-    output->isSymbolic = 1;
-  }
-  
-  return output;
+  return pINT_COMPARE(ms, input0, input1, VEC_CMP_SLT);
 }
 
 Vector *pINT_SLESSEQUAL(machine_state *ms, Vector *input0, Vector *input1) {
-  Vector *sless, *equal;
-  
-  sless = pINT_SLESS(ms, input0, input1);
-  if(!sless->isSymbolic) {
-    if(sless->conWord == 1) return sless;
-    vec_release(ms, sless);
-    return pINT_EQUAL(ms, input0, input1);
-  }
-  
-  equal = pINT_EQUAL(ms, input0, input1);
-  
-  if(!equal->isSymbolic) {
-    if(equal->conWord == 1) {
-      vec_release(ms, sless);
-      return equal;           
-    }
-    
-    vec_release(ms, equal);
-    return sless;
-  }
-  
-  sless->symWord[0] = Gia_ManHashOr(ms->ntk, sless->symWord[0], equal->symWord[0]);
-  vec_release(ms, equal);
-  
-  if(Gia_ManIsConstLit(sless->symWord[0])) {
-    //Concrete case
-    if(Gia_ManIsConst1Lit(sless->symWord[0])) {
-      sless->conWord = 1;
-    }
-  } else {
-    //Symbolic case
-    sless->isSymbolic = 1;
-  }
-  
-  return sless;
+  return pINT_COMPARE(ms, input0, input1, VEC_CMP_SLE);
 }
 
 Vector *pINT_SCARRY(machine_state *ms, Vector *input0, Vector *input1) {
   uintmax_t i;
   Vector *output = vec_get(ms, BITS_IN_BYTE);
   assert(input0->size == input1->size);
+  vec_force(ms, input0);
+  vec_force(ms, input1);
   
   if(!input0->isSymbolic) {
-    if(!input1->isSymbolic) {
+    if(!input1->isSymbolic && input0->size <= WORD_BITS) {
       //Concrete case
       intmax_t input0_se = int_sextend(input0->conWord, input0->size, WORD_BITS);
       intmax_t input1_se = int_sextend(input1->conWord, input1->size, WORD_BITS);
@@ -442,6 +419,7 @@ Vector *pINT_SCARRY(machine_state *ms, Vector *input0, Vector *input1) {
       return output;
     } else {
       vec_calc_sym(ms, input0);
+      if(!input1->isSymbolic) vec_calc_sym(ms, input1); //Wider than WORD_BITS
     }
   } else if(!input1->isSymbolic) {
     vec_calc_sym(ms, input1);
@@ -450,12 +428,21 @@ Vector *pINT_SCARRY(machine_state *ms, Vector *input0, Vector *input1) {
   //Symbolic case
   Gia_Lit_t carry = Gia_ManConst0Lit(); //Carry flag is initially false
   Gia_Lit_t carryin = carry;
-  for(i = 0; i < input0->size; i++) {
-    if(i == input0->size-1) carryin = carry;
-    //Majority vote
-    carry = Gia_ManHashMux(ms->ntk, carry,
+  if(ms->vec_adder != VEC_ADDER_RIPPLE && input0->size > 1) {
+    //Carry into the sign bit from the prefix network, then the sign bit's own carry
+    i = input0->size-1;
+    carryin = vec_prefix_add(ms, NULL, input0->symWord, input1->symWord, i, carry, 0);
+    carry = Gia_ManHashMux(ms->ntk, carryin,
 		       Gia_ManHashOr(ms->ntk, input0->symWord[i], input1->symWord[i]),
 		       Gia_ManHashAnd(ms->ntk, input0->symWord[i], input1->symWord[i]));
+  } else {
+    for(i = 0; i < input0->size; i++) {
+      if(i == input0->size-1) carryin = carry;
+      //Majority vote
+      carry = Gia_ManHashMux(ms->ntk, carry,
+			 Gia_ManHashOr(ms->ntk, input0->symWord[i], input1->symWord[i]),
+			 Gia_ManHashAnd(ms->ntk, input0->symWord[i], input1->symWord[i]));
+    }
   }
  
   for(i = 1; i < BITS_IN_BYTE; i++) {
@@ -481,16 +468,15 @@ Vector *pINT_SCARRY(machine_state *ms, Vector *input0, Vector *input1) {
 }
 
 Vector *pINT_SBORROW(machine_state *ms, Vector *input0, Vector *input1) {
-  Vector *input1c = pINT_2COMP(ms, input1);
-  Vector *output = pINT_SCARRY(ms, input0, input1c);
-  vec_release(ms, input1c);
-  return output;
+  return pINT_COMPARE(ms, input0, input1, VEC_CMP_OF);
 }
 
 Vector *pBOOL_OR(machine_state *ms, Vector *input0, Vector *input1) {
   uintmax_t i;
   assert(input0->size == BITS_IN_BYTE);
   assert(input1->size == BITS_IN_BYTE);
+  vec_force(ms, input0);
+  vec_force(ms, input1);
   
   Vector *output = vec_get(ms, BITS_IN_BYTE);
   
@@ -533,6 +519,8 @@ Vector *pBOOL_XOR(machine_state *ms, Vector *input0, Vector *input1) {
   uintmax_t i;
   assert(input0->size == BITS_IN_BYTE);
   assert(input1->size == BITS_IN_BYTE);
+  vec_force(ms, input0);
+  vec_force(ms, input1);
   
   Vector *output = vec_get(ms, BITS_IN_BYTE);
   
@@ -575,6 +563,8 @@ Vector *pBOOL_AND(machine_state *ms, Vector *input0, Vector *input1) {
   uintmax_t i;
   assert(input0->size == BITS_IN_BYTE);
   assert(input1->size == BITS_IN_BYTE);
+  vec_force(ms, input0);
+  vec_force(ms, input1);
   
   Vector *output = vec_get(ms, BITS_IN_BYTE);
   
@@ -616,6 +606,7 @@ Vector *pBOOL_AND(machine_state *ms, Vector *input0, Vector *input1) {
 Vector *pBOOL_NEGATE(machine_state *ms, Vector *input0) {
   uintmax_t i;
   assert(input0->size == BITS_IN_BYTE);
+  vec_force(ms, input0);
   
   Vector *output = vec_get(ms, BITS_IN_BYTE);
   
@@ -652,27 +643,36 @@ Vector *pSUBPIECE(machine_state *ms, Vector *input0, uintmax_t input1, uintmax_t
     return output;
   }
   
+  if(input0->term != 0 && (input1_bits + output_size_bits) <= input0->size) {
+    vec_term_set(ms, output, vec_term_node(ms, VEC_TERM_EXTRACT, output_size_bits, input0->term, 0, input1_bits));
+    return output;
+  }
+  vec_force(ms, input0);
+  
   if(!input0->isSymbolic) {
-    if(output_size_bits <= WORD_BITS) {
+    if(input0->size <= WORD_BITS && output_size_bits <= WORD_BITS) {
       output->conWord = int_zextend(input0->conWord, input0->size);
       output->conWord >>= input1_bits;
-      output->isSymbolic = 0;
-      return output;
+    } else {
+      //Wide concrete case
+      uintmax_t n = input0->size - input1_bits;
+      vec_con_clear(output);
+      vec_con_copybits(output, 0, input0, input1_bits, (n < output_size_bits) ? n : output_size_bits);
     }
-    vec_calc_sym(ms, input0);
+    output->isSymbolic = 0;
+    return output;
   }
   
-  uint8_t isSymbolic = (output->size > WORD_BITS);
-  for(i = 0; ((i+input1_bits) < input0->size) && (i < output_size_bits); i++) {
+  if((input1_bits + output_size_bits) <= input0->size && vec_view(ms, output, input0, input1_bits))
+    return output;
+  
+  for(i = 0; ((i+input1_bits) < input0->size) && (i < output_size_bits); i++)
     output->symWord[i] = input0->symWord[i+input1_bits];
-    if(!Gia_ManIsConstLit(output->symWord[i]))
-      isSymbolic = 1;
-  }
   
   for(; i < output_size_bits; i++)
     output->symWord[i] = Gia_ManConst0Lit();
   
-  if(isSymbolic)
+  if(!lits_all_const(output->symWord, output->size))
     output->isSymbolic = 1;
   else vec_sym_to_con(ms, output);
   
@@ -811,6 +811,8 @@ void conditional_branch(machine_state *ms, Gia_Lit_t condition,
     }
     
     //Make copies of the memories, one for each path
+    if(ms->memories_stack->head == 0)
+      cMemory_clean(ms, memories.cMem); //No enclosing branch will merge what was written before
     mem_copy_t.cMem = cMemory_copy(ms, memories.cMem);
     mem_copy_t.sMem = sMemory_copy(ms, memories.sMem);
     mem_copy_f.cMem = cMemory_copy(ms, memories.cMem);
@@ -822,6 +824,7 @@ void conditional_branch(machine_state *ms, Gia_Lit_t condition,
     arr_stack_push(ms->memories_stack, (void *)&mem_copy_f);
     push_condition(ms, condition, 1);
     assert(ms->branch_error == 0);
+    vec_force(ms, ms->heap_offset); //The copies below are held across the branches, which may collect
     Vector *orig_heap_offset = vec_dup(ms, ms->heap_offset);
 
     ms->memory = mem_copy_t;
@@ -832,6 +835,7 @@ void conditional_branch(machine_state *ms, Gia_Lit_t condition,
 
     memTuple t_branch_result = ms->memory;
     
+    vec_force(ms, ms->heap_offset);
     Vector *t_branch_heap_offset = vec_dup(ms, ms->heap_offset);
     
     uint8_t t_branch_error = ms->branch_error;
@@ -905,7 +909,7 @@ void conditional_branch(machine_state *ms, Gia_Lit_t condition,
       //ms->heap_offset = (t_branch_heap_offset > f_branch_heap_offset) ? t_branch_heap_offset : f_branch_heap_offset;
       Vector *c_branch_heap_offset = vec_ite(ms, condition, t_branch_heap_offset, f_branch_heap_offset);
       vec_release(ms, ms->heap_offset);
-      ms->heap_offset = c_branch_heap_offset;
+      ms->heap_offset = vec_scope_keep(ms, c_branch_heap_offset);
       assert(ms->branch_error == 0);
     }
     vec_release(ms, orig_heap_offset);
@@ -920,6 +924,7 @@ void conditional_branch(machine_state *ms, Gia_Lit_t condition,
 //Library functions
 
 void plib_malloc_32_x86_le(machine_state *ms) {
+  vec_scope_begin(ms);
   Vector *r_ESP_4_0 = cMemory_load_le(ms, 0x10, 4);
   Vector *c_0x4_4 = vec_getConstant(ms, 0x4, 4*BITS_IN_BYTE);
   Vector *r_ESP_4_1 = pINT_ADD(ms, r_ESP_4_0, c_0x4_4);
@@ -930,12 +935,9 @@ void plib_malloc_32_x86_le(machine_state *ms) {
   Vector *mallocSize = sMemory_load_le(ms, r_ESP_4_1, 4);
   Vector *new_heap_offset = vec_add(ms, ms->heap_offset, mallocSize);
   vec_release(ms, ms->heap_offset);
-  vec_release(ms, mallocSize);
-  ms->heap_offset = new_heap_offset;
+  ms->heap_offset = vec_scope_keep(ms, new_heap_offset);
   
-  vec_release(ms, r_ESP_4_1);
-  vec_release(ms, c_0x4_4);
-  vec_release(ms, r_ESP_4_0);
+  vec_scope_end(ms); //Releases the temporaries
 }
 
 void plib_free_32_x86_le(machine_state *ms) {
@@ -0,0 +1,183 @@
+#include "vectype.h"
+
+//Word-level rewriting
+//
+//Rules applied to an operation's operands before it builds any gates (or
+//any term). Structural hashing only merges identical AND nodes, so it
+//cannot see that x-x is zero or that (a+1)+1 is a+2; the address chains of
+//multi-byte loads and stores are full of both. Each rule is a bit of
+//ms->vec_rules and counts its hits in ms->vec_rule_hits.
+//
+//VEC_RULE_OFFSET needs to know that a sum is a base plus a constant. A
+//term records that itself; a bit-blasted sum is noted by vec_offset_note
+//in ms->vecOffsets, a small direct-mapped table of its own so that the
+//notes neither depend on ms->vec_memo nor evict its entries. Like the memo
+//cache it holds literals, so garbage_collect_ntk empties it.
+
+const char *vec_rule_names[VEC_RULE_COUNT] = {"self", "unit", "offset", "slice"};
+
+void vec_rewrite_init(machine_state *ms) {
+  ms->vec_rules = VEC_RULES_ALL;
+  memset(ms->vec_rule_hits, 0, sizeof(ms->vec_rule_hits));
+  ms->vecOffsets = NULL;
+}
+
+//True, and counted as a hit, if 'rule' is enabled
+uint8_t vec_rule_fire(machine_state *ms, uintmax_t rule) {
+  if(!((ms->vec_rules >> rule) & 1)) return 0;
+  ms->vec_rule_hits[rule]++;
+  return 1;
+}
+
+//True if x and y are known to be the same value without building gates.
+//Concrete operands are left to the kernels.
+uint8_t vec_same(machine_state *ms, Vector *x, Vector *y) {
+  if(x == y) return 1;
+  if(x->term != 0 || y->term != 0) return x->term == y->term;
+  if(!x->isSymbolic || !y->isSymbolic) return 0;
+  return lits_equal(x->symWord, y->symWord, x->size);
+}
+
+//The base of a sum of a symbolic vector and a constant, and the constant;
+//NULL if 'vec' is not known to be one
+Vector *vec_offset_of(machine_state *ms, Vector *vec, uintmax_t *offset) {
+  uintmax_t base, mask;
+
+  if(vec->term != 0) {
+    if(!vec_term_offset(ms, vec->term, &base, offset)) return NULL;
+    return vec_term_get(ms, base);
+  }
+  if(!vec->isSymbolic || vec->size > WORD_BITS || ms->vecOffsets == NULL) return NULL;
+  uintmax_t h = vec_memo_hash(VEC_OP_ADD, vec, vec);
+  vec_memo_entry *e = &ms->vecOffsets[h & (VEC_OFFSET_SIZE-1)];
+  if(e->lits == NULL || e->hash != h || e->x_size != vec->size ||
+     !vec_memo_match(e->lits, vec)) return NULL;
+
+  Vector *ret = vec_get(ms, vec->size);
+  vec_unshare(ms, ret);
+  memcpy(ret->symWord, e->lits + vec->size, vec->size * sizeof(Gia_Lit_t));
+  if(!vec_sym_to_con_attempt(ms, ret))
+    ret->isSymbolic = 1;
+  lits_pack(e->lits + 2*vec->size, vec->size, &mask, offset);
+  return ret;
+}
+
+//Record that 'ret' was built as x+y with exactly one of them concrete
+void vec_offset_note(machine_state *ms, Vector *x, Vector *y, Vector *ret) {
+  uintmax_t n = ret->size;
+
+  if(!((ms->vec_rules >> VEC_RULE_OFFSET) & 1)) return;
+  if(!ret->isSymbolic || n > WORD_BITS || x->isSymbolic == y->isSymbolic) return;
+  Vector *v = x->isSymbolic ? x : y;
+  Vector *c = x->isSymbolic ? y : x;
+
+  if(ms->vecOffsets == NULL)
+    ms->vecOffsets = (vec_memo_entry *)calloc(VEC_OFFSET_SIZE, sizeof(vec_memo_entry));
+  uintmax_t h = vec_memo_hash(VEC_OP_ADD, ret, ret);
+  vec_memo_entry *e = &ms->vecOffsets[h & (VEC_OFFSET_SIZE-1)];
+  //The sum's literals, then the base's, then the constant's
+  if(e->lits == NULL || e->x_size != n)
+    e->lits = (Gia_Lit_t *)realloc(e->lits, 3*n * sizeof(Gia_Lit_t));
+  e->hash = h;
+  e->op = VEC_OP_ADD;
+  e->x_size = n;
+  e->y_size = 0;
+  e->r_size = 2*n;
+  memcpy(e->lits, ret->symWord, n * sizeof(Gia_Lit_t));
+  memcpy(e->lits + n, v->symWord, n * sizeof(Gia_Lit_t));
+  lits_unpack(e->lits + 2*n, n, c->conWord);
+}
+
+//Forget every noted sum, for when literals are renumbered
+void vec_offset_flush(machine_state *ms) {
+  uintmax_t i;
+  if(ms->vecOffsets == NULL) return;
+  for(i = 0; i < VEC_OFFSET_SIZE; i++) {
+    free(ms->vecOffsets[i].lits);
+    ms->vecOffsets[i].lits = NULL;
+  }
+}
+
+void vec_offset_free(machine_state *ms) {
+  vec_offset_flush(ms);
+  free(ms->vecOffsets);
+  ms->vecOffsets = NULL;
+}
+
+//Result of 'op' (VEC_OP_ADD, SUB, MULT, AND, OR or XOR) on x and y if a rule
+//decides it without a new circuit, otherwise NULL
+Vector *vec_rewrite_binary(machine_state *ms, uintmax_t op, Vector *x, Vector *y) {
+  assert(x->size == y->size);
+  uintmax_t n = x->size;
+  if(!x->isSymbolic && !y->isSymbolic) return NULL; //The kernels fold constants
+
+  //x-x, x^x, x&x, x|x
+  if(vec_same(ms, x, y)) {
+    if((op == VEC_OP_SUB || op == VEC_OP_XOR) && vec_rule_fire(ms, VEC_RULE_SELF))
+      return vec_getConstant(ms, 0, n);
+    if((op == VEC_OP_AND || op == VEC_OP_OR) && vec_rule_fire(ms, VEC_RULE_SELF))
+      return vec_dup(ms, x);
+  }
+
+  //The rest need a concrete operand, c, of at most WORD_BITS. Only the
+  //second operand of a subtraction counts.
+  Vector *v = x, *c = y;
+  if(!x->isSymbolic && op != VEC_OP_SUB) {
+    v = y;
+    c = x;
+  }
+  if(c->isSymbolic || n > WORD_BITS) return NULL;
+  uintmax_t k = int_zextend(c->conWord, n);
+  uintmax_t ones = int_zextend(~((uintmax_t)0), n);
+
+  if(k == 0) {
+    if((op == VEC_OP_MULT || op == VEC_OP_AND) && vec_rule_fire(ms, VEC_RULE_UNIT))
+      return vec_getConstant(ms, 0, n);
+    if(vec_rule_fire(ms, VEC_RULE_UNIT))
+      return vec_dup(ms, v);
+  }
+  if((k == 1 && op == VEC_OP_MULT) || (k == ones && op == VEC_OP_AND))
+    if(vec_rule_fire(ms, VEC_RULE_UNIT))
+      return vec_dup(ms, v);
+  if(k == ones && op == VEC_OP_OR && vec_rule_fire(ms, VEC_RULE_UNIT))
+    return vec_getConstant(ms, ones, n);
+
+  //x-c is x+(-c), so both chain through the same base. vec_add counts
+  //the hit if the offsets then combine.
+  if(op == VEC_OP_SUB && ((ms->vec_rules >> VEC_RULE_OFFSET) & 1)) {
+    Vector *neg = vec_getConstant(ms, int_zextend(-k, n), n);
+    Vector *ret = vec_add(ms, v, neg);
+    vec_release(ms, neg);
+    return ret;
+  }
+
+  //(a+c1)+c2 is a+(c1+c2)
+  if(op == VEC_OP_ADD) {
+    uintmax_t offset;
+    Vector *base = vec_offset_of(ms, v, &offset);
+    if(base == NULL) return NULL;
+    if(!vec_rule_fire(ms, VEC_RULE_OFFSET)) {
+      vec_release(ms, base);
+      return NULL;
+    }
+    offset = int_zextend(offset + k, n);
+    if(offset == 0) return base;
+    Vector *sum = vec_getConstant(ms, offset, n);
+    Vector *ret = vec_add(ms, base, sum);
+    vec_release(ms, sum);
+    vec_release(ms, base);
+    return ret;
+  }
+
+  return NULL;
+}
+
+void vec_rewrite_report(machine_state *ms, FILE *out) {
+  uintmax_t i;
+  fprintf(out, "Rewrite rules:");
+  for(i = 0; i < VEC_RULE_COUNT; i++)
+    fprintf(out, " %s=%ju%s", vec_rule_names[i], ms->vec_rule_hits[i],
+	    ((ms->vec_rules >> i) & 1) ? "" : "(off)");
+  fprintf(out, "\n");
+  fflush(out);
+}
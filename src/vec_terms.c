@@ -0,0 +1,324 @@
+#include "vectype.h"
+
+//Word-level terms
+//
+//With ms->vec_lazy set, vec_add, vec_sub, vec_mult, vec_ite, slices and
+//concatenations of symbolic vectors build a term instead of gates. The
+//result is a Vector whose .term names the node and whose literals are not
+//filled in. Terms are hash-consed, so the same operation on the same
+//operands is one node. vec_force bit-blasts a term, once, when something
+//needs its bits: a comparison (and so every branch condition and SAT
+//query), vec_setAsOutput, a probe, or any kernel that is not term-aware.
+//A value stored to memory and overwritten before it is read never becomes
+//gates. Term ids carry the epoch they were made in, as vec_term_flush
+//(every garbage_collect_ntk) throws the table away. Kernels that read
+//the literals of their own add, sub, mult or ite results must force them.
+
+#define VEC_TERM_INDEX(term) ((term) & 0xffffffffu)
+#define VEC_TERM_EPOCH(term) ((term) >> 32)
+
+void vec_term_init(machine_state *ms) {
+  ms->vec_lazy = 0;
+  ms->vecTerms_head = 1;
+  ms->vecTerms_size = REALLOC_DELTA;
+  ms->vecTerms = (vec_term *)malloc(ms->vecTerms_size * sizeof(vec_term));
+  ms->vecTermHash_size = 256;
+  ms->vecTermHash = (uintmax_t *)calloc(ms->vecTermHash_size, sizeof(uintmax_t));
+  ms->vecTermEpoch = 0;
+  ms->vec_terms_made = 0;
+  ms->vec_terms_reused = 0;
+  ms->vec_terms_lowered = 0;
+}
+
+//Forget every term. Vectors still holding one must have been forced first.
+//garbage_collect_ntk forces only its roots (the memories and the rest of
+//machine_state_gc_roots); any other vector that holds a term and outlives
+//the collection must be forced by its owner before the call, or it exits
+//in vec_term_ptr on its next use.
+void vec_term_flush(machine_state *ms) {
+  uintmax_t i;
+  for(i = 1; i < ms->vecTerms_head; i++)
+    free(ms->vecTerms[i].lits);
+  ms->vecTerms_head = 1;
+  memset(ms->vecTermHash, 0, ms->vecTermHash_size * sizeof(uintmax_t));
+  ms->vecTermEpoch++;
+}
+
+void vec_term_free(machine_state *ms) {
+  vec_term_flush(ms);
+  free(ms->vecTerms);
+  ms->vecTerms = NULL;
+  free(ms->vecTermHash);
+  ms->vecTermHash = NULL;
+}
+
+vec_term *vec_term_ptr(machine_state *ms, uintmax_t term) {
+  if(VEC_TERM_EPOCH(term) != ms->vecTermEpoch) {
+    fprintf(stderr, "Error: Vector holds a term from before the last garbage collection...exiting\n");
+    assert(0);
+    exit(0);
+  }
+  assert(VEC_TERM_INDEX(term) != 0 && VEC_TERM_INDEX(term) < ms->vecTerms_head);
+  return &ms->vecTerms[VEC_TERM_INDEX(term)];
+}
+
+uintmax_t vec_term_id(machine_state *ms, uintmax_t index) {
+  return index | (ms->vecTermEpoch << 32);
+}
+
+uintmax_t vec_term_hash(uint8_t op, uintmax_t size, uintmax_t a, uintmax_t b, uintmax_t aux, Gia_Lit_t *lits) {
+  uintmax_t i;
+  uint64_t h = 0xcbf29ce484222325ULL; //FNV-1a
+  h = (h ^ op) * 0x100000001b3ULL;
+  h = (h ^ size) * 0x100000001b3ULL;
+  h = (h ^ a) * 0x100000001b3ULL;
+  h = (h ^ b) * 0x100000001b3ULL;
+  h = (h ^ aux) * 0x100000001b3ULL;
+  if(lits != NULL)
+    for(i = 0; i < size; i++)
+      h = (h ^ lits[i]) * 0x100000001b3ULL;
+  return h;
+}
+
+//Slot of ms->vecTermHash holding the term, or the empty slot where it goes
+uintmax_t vec_term_slot(machine_state *ms, uintmax_t h, uint8_t op, uintmax_t size, uintmax_t a, uintmax_t b, uintmax_t aux, Gia_Lit_t *lits) {
+  uintmax_t slot = h & (ms->vecTermHash_size - 1);
+  while(ms->vecTermHash[slot] != 0) {
+    vec_term *t = &ms->vecTerms[ms->vecTermHash[slot] - 1];
+    if(t->hash == h && t->op == op && t->size == size && t->args[0] == a && t->args[1] == b && t->aux == aux &&
+       (lits == NULL || lits_equal(t->lits, lits, size)))
+      break;
+    slot = (slot + 1) & (ms->vecTermHash_size - 1);
+  }
+  return slot;
+}
+
+//The one term for (op, size, a, b, aux); 'lits' are the literals of a
+//VEC_TERM_BITS leaf and NULL otherwise
+uintmax_t vec_term_intern(machine_state *ms, uint8_t op, uintmax_t size, uintmax_t a, uintmax_t b, uintmax_t aux, Gia_Lit_t *lits) {
+  uintmax_t i;
+  uintmax_t h = vec_term_hash(op, size, a, b, aux, lits);
+  uintmax_t slot = vec_term_slot(ms, h, op, size, a, b, aux, lits);
+  if(ms->vecTermHash[slot] != 0) {
+    ms->vec_terms_reused++;
+    return vec_term_id(ms, ms->vecTermHash[slot] - 1);
+  }
+  
+  if(ms->vecTerms_head == ms->vecTerms_size) {
+    ms->vecTerms_size += ms->vecTerms_size / 2;
+    ms->vecTerms = (vec_term *)realloc(ms->vecTerms, ms->vecTerms_size * sizeof(vec_term));
+  }
+  assert(ms->vecTerms_head <= 0xffffffffu);
+  vec_term *t = &ms->vecTerms[ms->vecTerms_head];
+  t->op = op;
+  t->size = size;
+  t->args[0] = a;
+  t->args[1] = b;
+  t->aux = aux;
+  t->hash = h;
+  t->lits = NULL;
+  if(lits != NULL) {
+    t->lits = (Gia_Lit_t *)malloc(size * sizeof(Gia_Lit_t));
+    memcpy(t->lits, lits, size * sizeof(Gia_Lit_t));
+  }
+  ms->vecTermHash[slot] = ++ms->vecTerms_head; //Index + 1, so 0 is an empty slot
+  ms->vec_terms_made++;
+  
+  if(2*ms->vecTerms_head > ms->vecTermHash_size) {
+    //Keep the table at most half full
+    free(ms->vecTermHash);
+    ms->vecTermHash_size *= 2;
+    ms->vecTermHash = (uintmax_t *)calloc(ms->vecTermHash_size, sizeof(uintmax_t));
+    for(i = 1; i < ms->vecTerms_head; i++) {
+      vec_term *u = &ms->vecTerms[i];
+      uintmax_t s = vec_term_slot(ms, u->hash, u->op, u->size, u->args[0], u->args[1], u->aux,
+				  (u->op == VEC_TERM_BITS) ? u->lits : NULL);
+      ms->vecTermHash[s] = i+1;
+    }
+  }
+  return vec_term_id(ms, ms->vecTerms_head - 1);
+}
+
+//Term for 'op' on a (and b), after the simplifications that need no gates:
+//slices of slices and of concatenations, concatenations of adjacent slices,
+//constant folding of slices (VEC_RULE_SLICE), and if-then-else with equal
+//arms (VEC_RULE_SELF) or a constant condition.
+uintmax_t vec_term_node(machine_state *ms, uint8_t op, uintmax_t size, uintmax_t a, uintmax_t b, uintmax_t aux) {
+  vec_term *ta = (a != 0) ? vec_term_ptr(ms, a) : NULL;
+  vec_term *tb = (b != 0) ? vec_term_ptr(ms, b) : NULL;
+  
+  switch(op) {
+  case VEC_TERM_EXTRACT:
+    assert(aux + size <= ta->size);
+    if(aux == 0 && size == ta->size) return a;
+    if(ta->op == VEC_TERM_EXTRACT && vec_rule_fire(ms, VEC_RULE_SLICE))
+      return vec_term_node(ms, VEC_TERM_EXTRACT, size, ta->args[0], 0, ta->aux + aux);
+    if(ta->op == VEC_TERM_CONST && vec_rule_fire(ms, VEC_RULE_SLICE))
+      return vec_term_intern(ms, VEC_TERM_CONST, size, 0, 0, int_zextend(ta->aux >> aux, size), NULL);
+    if(ta->op == VEC_TERM_CAT) {
+      uintmax_t lo_size = vec_term_ptr(ms, ta->args[1])->size;
+      if(aux + size <= lo_size && vec_rule_fire(ms, VEC_RULE_SLICE))
+	return vec_term_node(ms, VEC_TERM_EXTRACT, size, ta->args[1], 0, aux);
+      if(aux >= lo_size && vec_rule_fire(ms, VEC_RULE_SLICE))
+	return vec_term_node(ms, VEC_TERM_EXTRACT, size, ta->args[0], 0, aux - lo_size);
+    }
+    break;
+  case VEC_TERM_CAT:
+    assert(ta->size + tb->size == size);
+    if(ta->op == VEC_TERM_EXTRACT && tb->op == VEC_TERM_EXTRACT &&
+       ta->args[0] == tb->args[0] && ta->aux == tb->aux + tb->size && vec_rule_fire(ms, VEC_RULE_SLICE))
+      return vec_term_node(ms, VEC_TERM_EXTRACT, size, ta->args[0], 0, tb->aux);
+    if(ta->op == VEC_TERM_CONST && tb->op == VEC_TERM_CONST && size <= WORD_BITS && vec_rule_fire(ms, VEC_RULE_SLICE))
+      return vec_term_intern(ms, VEC_TERM_CONST, size, 0, 0, (ta->aux << tb->size) | tb->aux, NULL);
+    break;
+  case VEC_TERM_ITE:
+    if(a == b && vec_rule_fire(ms, VEC_RULE_SELF)) return a;
+    if(Gia_ManIsConst1Lit(aux)) return a;
+    if(Gia_ManIsConst0Lit(aux)) return b;
+    break;
+  case VEC_TERM_ADD:
+  case VEC_TERM_MULT:
+    //Commutative, so keep the operands in one order
+    if(a > b) { uintmax_t tmp = a; a = b; b = tmp; }
+    break;
+  }
+  return vec_term_intern(ms, op, size, a, b, aux, NULL);
+}
+
+//If 'term' adds a constant to another term, that term and the constant
+uint8_t vec_term_offset(machine_state *ms, uintmax_t term, uintmax_t *base, uintmax_t *offset) {
+  vec_term *t = vec_term_ptr(ms, term);
+  if(t->op != VEC_TERM_ADD) return 0;
+  vec_term *ta = vec_term_ptr(ms, t->args[0]);
+  vec_term *tb = vec_term_ptr(ms, t->args[1]);
+  if(tb->op == VEC_TERM_CONST) {
+    *base = t->args[0];
+    *offset = tb->aux;
+    return 1;
+  }
+  if(ta->op == VEC_TERM_CONST) {
+    *base = t->args[1];
+    *offset = ta->aux;
+    return 1;
+  }
+  return 0;
+}
+
+//The term 'vec' stands for: its own if it has one, otherwise a leaf
+uintmax_t vec_term_of(machine_state *ms, Vector *vec) {
+  if(vec->term != 0) return vec->term;
+  if(!vec->isSymbolic) {
+    if(vec->size <= WORD_BITS)
+      return vec_term_intern(ms, VEC_TERM_CONST, vec->size, 0, 0, int_zextend(vec->conWord, vec->size), NULL);
+    vec_calc_sym(ms, vec);
+  }
+  return vec_term_intern(ms, VEC_TERM_BITS, vec->size, 0, 0, 0, vec->symWord);
+}
+
+//A vector, with its literals, holding the value of term 't'
+Vector *vec_term_eager(machine_state *ms, uintmax_t t) {
+  Gia_Lit_t *lits = vec_term_lits(ms, t);
+  Vector *vec = vec_get(ms, vec_term_ptr(ms, t)->size);
+  memcpy(vec->symWord, lits, vec->size * sizeof(Gia_Lit_t));
+  if(!vec_sym_to_con_attempt(ms, vec))
+    vec->isSymbolic = 1;
+  return vec;
+}
+
+//Literals of a term, bit-blasting it (and whatever it is built from) on
+//first use with the same kernels the eager operations use
+Gia_Lit_t *vec_term_lits(machine_state *ms, uintmax_t term) {
+  vec_term *t = vec_term_ptr(ms, term);
+  if(t->lits != NULL) return t->lits;
+  
+  uint8_t op = t->op;
+  uintmax_t size = t->size, a = t->args[0], b = t->args[1], aux = t->aux;
+  Gia_Lit_t *lits = (Gia_Lit_t *)malloc(size * sizeof(Gia_Lit_t));
+  
+  if(op == VEC_TERM_CONST) {
+    lits_unpack(lits, size, aux);
+  } else if(op == VEC_TERM_EXTRACT) {
+    memcpy(lits, vec_term_lits(ms, a) + aux, size * sizeof(Gia_Lit_t));
+  } else if(op == VEC_TERM_CAT) {
+    uintmax_t lo_size = vec_term_ptr(ms, b)->size;
+    memcpy(lits, vec_term_lits(ms, b), lo_size * sizeof(Gia_Lit_t));
+    memcpy(lits + lo_size, vec_term_lits(ms, a), (size - lo_size) * sizeof(Gia_Lit_t));
+  } else {
+    uint8_t lazy = ms->vec_lazy;
+    ms->vec_lazy = 0;
+    Vector *x = vec_term_eager(ms, a);
+    Vector *y = vec_term_eager(ms, b);
+    Vector *r;
+    switch(op) {
+    case VEC_TERM_ADD: r = vec_add(ms, x, y); break;
+    case VEC_TERM_SUB: r = vec_sub(ms, x, y); break;
+    case VEC_TERM_MULT: r = vec_mult(ms, x, y); break;
+    case VEC_TERM_ITE: r = vec_ite(ms, (Gia_Lit_t)aux, x, y); break;
+    default: assert(0); r = NULL;
+    }
+    ms->vec_lazy = lazy;
+    if(!r->isSymbolic) vec_calc_sym(ms, r);
+    memcpy(lits, r->symWord, size * sizeof(Gia_Lit_t));
+    vec_release(ms, r);
+    vec_release(ms, y);
+    vec_release(ms, x);
+  }
+  
+  t = vec_term_ptr(ms, term);
+  t->lits = lits;
+  ms->vec_terms_lowered++;
+  return lits;
+}
+
+//Make 'vec' hold the value of 'term'. Leaves are written out directly.
+void vec_term_set(machine_state *ms, Vector *vec, uintmax_t term) {
+  vec_term *t = vec_term_ptr(ms, term);
+  assert(t->size == vec->size);
+  if(t->op == VEC_TERM_CONST) {
+    vec_setValue(ms, vec, t->aux);
+  } else if(t->op == VEC_TERM_BITS) {
+    vec_unshare(ms, vec);
+    memcpy(vec->symWord, t->lits, vec->size * sizeof(Gia_Lit_t));
+    if(!vec_sym_to_con_attempt(ms, vec))
+      vec->isSymbolic = 1;
+  } else {
+    vec_unshare(ms, vec);
+    vec->term = term;
+    vec->isSymbolic = 1;
+  }
+}
+
+Vector *vec_term_get(machine_state *ms, uintmax_t term) {
+  Vector *vec = vec_get(ms, vec_term_ptr(ms, term)->size);
+  vec_term_set(ms, vec, term);
+  return vec;
+}
+
+//True if an operation on x and y should build a term. Operations on
+//concrete values are cheap and stay eager.
+uint8_t vec_term_wanted(machine_state *ms, Vector *x, Vector *y) {
+  return ms->vec_lazy && (x->isSymbolic || y->isSymbolic);
+}
+
+Vector *vec_term_binary(machine_state *ms, uint8_t op, Vector *x, Vector *y) {
+  assert(x->size == y->size);
+  uintmax_t a = vec_term_of(ms, x);
+  uintmax_t b = vec_term_of(ms, y);
+  return vec_term_get(ms, vec_term_node(ms, op, x->size, a, b, 0));
+}
+
+//Build the literals of a term vector; a no-op for any other vector
+void vec_force(machine_state *ms, Vector *vec) {
+  if(vec->term == 0) return;
+  Gia_Lit_t *lits = vec_term_lits(ms, vec->term);
+  vec_unshare(ms, vec); //Clears .term
+  memcpy(vec->symWord, lits, vec->size * sizeof(Gia_Lit_t));
+  if(!vec_sym_to_con_attempt(ms, vec))
+    vec->isSymbolic = 1;
+}
+
+void vec_term_report(machine_state *ms, FILE *out) {
+  fprintf(out, "Word-level terms: made=%ju, reused=%ju, lowered=%ju, live=%ju\n",
+	  ms->vec_terms_made, ms->vec_terms_reused, ms->vec_terms_lowered, ms->vecTerms_head - 1);
+  fflush(out);
+}
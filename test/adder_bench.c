@@ -0,0 +1,87 @@
+#include <pcode_definitions.h>
+
+//Compares the ripple carry adder with the Kogge-Stone and Brent-Kung
+//parallel-prefix adders (ms->vec_adder). For each width it builds x+y,
+//x-y, the carry and the signed carry of two fresh inputs and reports the
+//new AND nodes, the deepest output and the time the SAT sweeper spends
+//checking (x+y)-y == x. Every output is also proven equal to the ripple
+//carry adder's, and the program exits with 1 at the first mismatch.
+
+const char *adder_names[] = {"ripple", "kogge-stone", "brent-kung"};
+const char *output_names[] = {"x+y", "x-y", "signed carry"};
+
+//Rebuild the outputs with the ripple carry adder and prove them equal
+void check(machine_state *ms, Vector *x, Vector *y, Vector **outputs, Gia_Lit_t carry, uint8_t adder) {
+  uintmax_t i;
+  Vector *ref[3];
+  ms->vec_adder = VEC_ADDER_RIPPLE;
+  ref[0] = vec_add(ms, x, y);
+  ref[1] = vec_sub(ms, x, y);
+  ref[2] = pINT_SCARRY(ms, x, y);
+  Gia_Lit_t ref_carry = vec_carry(ms, x, y);
+  ms->vec_adder = adder;
+
+  i = vec_find_unequal(ms, outputs, ref, 3);
+  if(i < 3 || lit_equal_SAT(ms, carry, ref_carry, 1) != Gia_ManConst1Lit()) {
+    fprintf(stderr, "MISMATCH: %ju bit %s %s differs from ripple carry\n",
+	    x->size, adder_names[adder], i < 3 ? output_names[i] : "carry");
+    exit(1);
+  }
+
+  for(i = 0; i < 3; i++)
+    vec_release(ms, ref[i]);
+}
+
+void bench(machine_state *ms, uintmax_t width, uint8_t adder) {
+  uintmax_t i;
+  struct timeval start, end;
+  Vector *outputs[3];
+  int depth;
+  ms->vec_adder = adder;
+
+  Vector *x = vec_getInput(ms, width, "x");
+  Vector *y = vec_getInput(ms, width, "y");
+
+  int ands = Gia_ManAndNum(ms->ntk);
+  outputs[0] = vec_add(ms, x, y);
+  outputs[1] = vec_sub(ms, x, y);
+  outputs[2] = pINT_SCARRY(ms, x, y);
+  Gia_Lit_t carry = vec_carry(ms, x, y);
+  ands = Gia_ManAndNum(ms->ntk) - ands;
+
+  Gia_ManLevelNum(ms->ntk);
+  depth = lit_depth(ms, carry);
+  for(i = 0; i < 3; i++)
+    if(vec_depth(ms, outputs[i]) > depth) depth = vec_depth(ms, outputs[i]);
+
+  Vector *back = vec_sub(ms, outputs[0], y);
+  gettimeofday(&start, NULL);
+  vec_equal_SAT(ms, back, x, 1);
+  gettimeofday(&end, NULL);
+  double sat_ms = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+
+  fprintf(stdout, "%3ju bits %-12s ANDs=%-6d depth=%-4d SAT=%.2fms\n",
+	  width, adder_names[adder], ands, depth, sat_ms);
+
+  check(ms, x, y, outputs, carry, adder);
+
+  vec_release(ms, back);
+  for(i = 0; i < 3; i++)
+    vec_release(ms, outputs[i]);
+  vec_release(ms, y);
+  vec_release(ms, x);
+}
+
+int main() {
+  uintmax_t width;
+  uint8_t adder;
+  machine_state *ms = machine_state_init("adder_bench.c", 0, 12, 0x20000000, 32);
+
+  for(width = 8; width <= 128; width *= 2)
+    for(adder = VEC_ADDER_RIPPLE; adder <= VEC_ADDER_BRENT_KUNG; adder++)
+      bench(ms, width, adder);
+
+  machine_state_free(ms);
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <pcode_definitions.h>
+
+//Checks the paged cMemory of src/memory.c by looking at its pages as well
+//as loading from it: pages appear on the first store, copies share them
+//until one side stores, cMemory_ite merges only the bytes either side
+//stored to, and concrete words load the same whether or not they cross a
+//page.
+
+#define PAGE CMEM_PAGE_SIZE
+
+void fail(const char *what) {
+  fprintf(stderr, "MISMATCH: %s\n", what);
+  exit(1);
+}
+
+void store(machine_state *ms, cMemory *cMem, uintmax_t address, Vector *value) {
+  ms->memory.cMem = cMem;
+  cMemory_store_le(ms, address, value, value->size/BITS_IN_BYTE);
+}
+
+void store_con(machine_state *ms, cMemory *cMem, uintmax_t address, uintmax_t value, uintmax_t size) {
+  Vector *vec = vec_getConstant(ms, value, size*BITS_IN_BYTE);
+  store(ms, cMem, address, vec);
+  vec_release(ms, vec);
+}
+
+//Fails unless the 'size' bytes at 'address' of cMem are 'want' whenever
+//the conditions pushed hold
+void expect(machine_state *ms, cMemory *cMem, uintmax_t address, Vector *want, const char *what) {
+  ms->memory.cMem = cMem;
+  Vector *got = cMemory_load_le(ms, address, want->size/BITS_IN_BYTE);
+  if(vec_equal_SAT(ms, got, want, 1) != Gia_ManConst1Lit()) fail(what);
+  vec_release(ms, got);
+}
+
+void expect_con(machine_state *ms, cMemory *cMem, uintmax_t address, uintmax_t value, uintmax_t size, const char *what) {
+  Vector *want = vec_getConstant(ms, value, size*BITS_IN_BYTE);
+  expect(ms, cMem, address, want, what);
+  vec_release(ms, want);
+}
+
+//Only the pages stored to are allocated; the rest read as unwritten zeros
+void test_pages(machine_state *ms, cMemory *cMem) {
+  uintmax_t p;
+  for(p = 0; p < cMem->num_pages; p++)
+    if(cMem->pages[p] != NULL) fail("a page exists before any store");
+
+  store_con(ms, cMem, 2*PAGE + 5, 0xab, 1);
+  for(p = 0; p < cMem->num_pages; p++)
+    if((cMem->pages[p] != NULL) != (p == 2)) fail("a store allocates a page other than its own");
+  expect_con(ms, cMem, 2*PAGE + 5, 0xab, 1, "a stored byte reads back");
+
+  ms->memory.cMem = cMem;
+  if(cMemory_load_rbw(ms, 5, 1) != Gia_ManConst1Lit()) fail("a byte on an unallocated page is not unwritten");
+  if(cMemory_load_rbw(ms, 2*PAGE + 4, 1) != Gia_ManConst1Lit()) fail("a neighbour of a stored byte is not unwritten");
+  if(cMemory_load_rbw(ms, 2*PAGE + 5, 1) != Gia_ManConst0Lit()) fail("a stored byte is unwritten");
+  fprintf(stdout, "pages are allocated on first store\n");
+}
+
+//A copy shares every page until a store, which copies only the page
+//stored to and leaves the original alone
+void test_cow(machine_state *ms, cMemory *cMem) {
+  uintmax_t p;
+  store_con(ms, cMem, 10, 0x1234, 2);
+  cMemory *copy = cMemory_copy(ms, cMem);
+  for(p = 0; p < cMem->num_pages; p++)
+    if(copy->pages[p] != cMem->pages[p]) fail("a copy does not share a page");
+  if(cMem->pages[0]->refs != 2) fail("a shared page is not counted twice");
+
+  store_con(ms, copy, 11, 0x56, 1);
+  if(copy->pages[0] == cMem->pages[0]) fail("a store into a shared page does not copy it");
+  if(cMem->pages[0]->refs != 1 || copy->pages[0]->refs != 1) fail("a page copied on store is still counted as shared");
+  if(copy->pages[2] != cMem->pages[2]) fail("a store copies a page it does not touch");
+  expect_con(ms, copy, 10, 0x5634, 2, "the copy reads its own store");
+  expect_con(ms, cMem, 10, 0x1234, 2, "the original sees the copy's store");
+
+  cMemory_free(ms, copy);
+  if(cMem->pages[2]->refs != 1) fail("freeing a copy leaves its shared pages counted");
+  ms->memory.cMem = cMem;
+  fprintf(stdout, "pages are shared until a store\n");
+}
+
+//Branch on c, store on one side or both, and merge; only those bytes
+//become muxes, and a page neither side stored to stays the parent's
+void test_merge(machine_state *ms, cMemory *cMem) {
+  Vector *x = vec_getInput(ms, BITS_IN_BYTE, "x");
+  Vector *cond = vec_getInput(ms, 1, "c");
+  Gia_Lit_t c = cond->symWord[0];
+  cMemoryPage *untouched = cMem->pages[2];
+
+  store_con(ms, cMem, 20, 0x0807060504030201ULL, 8);
+  cMemory_clean(ms, cMem);
+  cMemory *t = cMemory_copy(ms, cMem);
+  cMemory *f = cMemory_copy(ms, cMem);
+  store(ms, t, 21, x);                   //True side only, symbolic
+  store_con(ms, t, 22, 0x11, 1);         //Both sides, differing
+  store_con(ms, f, 22, 0x22, 1);
+  store_con(ms, t, 23, 0x04, 1);         //Both sides, the same
+  store_con(ms, f, 23, 0x04, 1);
+  store_con(ms, f, 3*PAGE, 0x33, 1);     //False side only, on a page the true side never had
+
+  cMemory *merged = cMemory_ite(ms, c, t, f);
+  if(merged->pages[2] != untouched) fail("a page neither side stored to is not the parent's");
+  if(merged->pages[0] == cMem->pages[0]) fail("a merged page is still the parent's");
+  if(merged->dirty[0] == NULL || merged->dirty[0][0] != (0x7ULL << 21)) fail("the merged dirty bytes are not the union of both sides'");
+  if(merged->dirty[3] == NULL || merged->dirty[3][0] != 1) fail("the dirty bytes of a page only the false side stored to are lost");
+  expect_con(ms, merged, 23, 0x04, 1, "a byte both sides stored the same value to");
+  expect_con(ms, merged, 24, 0x08070605, 4, "bytes neither side stored to");
+  expect_con(ms, merged, 3*PAGE, 0x33, 1, "a page only the false side stored to");
+
+  push_condition(ms, c, 1);
+  expect(ms, merged, 21, x, "the true side's store under c");
+  expect_con(ms, merged, 22, 0x11, 1, "the true side's byte under c");
+  pop_condition(ms);
+  push_condition(ms, c, 0);
+  expect_con(ms, merged, 21, 0x02, 1, "the parent's byte under !c");
+  expect_con(ms, merged, 22, 0x22, 1, "the false side's byte under !c");
+  pop_condition(ms);
+
+  expect_con(ms, cMem, 20, 0x0807060504030201ULL, 8, "the parent after the merge");
+  ms->memory.cMem = cMem;
+  if(cMemory_load_rbw(ms, 3*PAGE, 1) != Gia_ManConst1Lit()) fail("the parent sees a store from a branch");
+
+  cMemory_free(ms, merged);
+  ms->memory.cMem = cMem;
+  vec_release(ms, cond);
+  vec_release(ms, x);
+  fprintf(stdout, "merges only touch the bytes stored to\n");
+}
+
+//Concrete words load the same on the fast path, across a page boundary
+//where it does not apply, and around a symbolic byte
+void test_words(machine_state *ms, cMemory *cMem) {
+  uintmax_t size, i;
+  Vector *x = vec_getInput(ms, BITS_IN_BYTE, "w");
+
+  for(size = 1; size <= 8; size *= 2) {
+    uintmax_t value = int_zextend(0x8877665544332211ULL, size*BITS_IN_BYTE);
+    uintmax_t swapped = 0;
+    for(i = 0; i < size; i++)
+      swapped |= ((value >> (i*BITS_IN_BYTE)) & 0xff) << ((size-1-i)*BITS_IN_BYTE);
+
+    store_con(ms, cMem, PAGE + 64, value, size);
+    expect_con(ms, cMem, PAGE + 64, value, size, "a word within a page");
+    store_con(ms, cMem, 2*PAGE - size/2, value, size);
+    expect_con(ms, cMem, 2*PAGE - size/2, value, size, "a word across a page boundary");
+
+    ms->memory.cMem = cMem;
+    Vector *be = cMemory_load_be(ms, 2*PAGE - size/2, size);
+    if(be->isSymbolic || int_zextend(be->conWord, be->size) != swapped) fail("a big endian word across a page boundary");
+    vec_release(ms, be);
+  }
+
+  store_con(ms, cMem, PAGE + 128, 0x44332211, 4);
+  store(ms, cMem, PAGE + 130, x);
+  ms->memory.cMem = cMem;
+  Vector *word = cMemory_load_le(ms, PAGE + 128, 4);
+  if(!word->isSymbolic) fail("a word holding a symbolic byte is concrete");
+  for(i = 0; i < 4; i++) {
+    Vector *byte = vec_extract(ms, word, i*BITS_IN_BYTE, BITS_IN_BYTE);
+    Vector *want = (i == 2) ? vec_dup(ms, x) : vec_getConstant(ms, (0x44332211 >> (i*BITS_IN_BYTE)) & 0xff, BITS_IN_BYTE);
+    if(vec_equal_SAT(ms, byte, want, 1) != Gia_ManConst1Lit()) fail("a word holding a symbolic byte");
+    vec_release(ms, want);
+    vec_release(ms, byte);
+  }
+
+  vec_release(ms, word);
+  vec_release(ms, x);
+  fprintf(stdout, "concrete words load the same across pages\n");
+}
+
+int main() {
+  machine_state *ms = machine_state_init("cmem_test.c", 0, 4*PAGE, 0x20000000, 32);
+  cMemory *cMem = ms->memory.cMem;
+
+  test_pages(ms, cMem);
+  test_cow(ms, cMem);
+  test_merge(ms, cMem);
+  test_words(ms, cMem);
+
+  machine_state_free(ms);
+
+  return 0;
+}
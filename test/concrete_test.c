@@ -0,0 +1,89 @@
+#include <pcode_definitions.h>
+
+//Replays a small computation on a machine state from
+//machine_state_init_concrete. An array of words is stored little-endian,
+//loaded back and folded with p-code arithmetic, and the total is stored
+//big-endian and read back a byte at a time. Every load and result must be
+//the value C computes, and no AND node may be built.
+
+#define NUM_WORDS 8
+#define ARRAY_BASE 0x10
+#define TOTAL_ADDR 0x40
+
+void expect(machine_state *ms, Vector *got, uintmax_t want, const char *what, uintmax_t i) {
+  want = int_zextend(want, got->size);
+  if(!got->isSymbolic && int_zextend(got->conWord, got->size) == want) {
+    vec_release(ms, got);
+    return;
+  }
+  fprintf(stderr, "MISMATCH: %s %ju is 0x%jx, not 0x%jx\n", what, i, got->conWord, want);
+  exit(1);
+}
+
+int main() {
+  uintmax_t i;
+  uint32_t words[NUM_WORDS] = {7, 0xffffffff, 0x80000000, 12345, 0xdeadbeef, 1, 0x7fffffff, 42};
+  uint32_t total = 0;
+  machine_state *ms = machine_state_init_concrete(0, 0x80, 0x20000000, 32);
+
+  for(i = 0; i < NUM_WORDS; i++) {
+    Vector *word = vec_getConstant(ms, words[i], 32);
+    cMemory_store_le(ms, ARRAY_BASE + 4*i, word, 4);
+    vec_release(ms, word);
+  }
+
+  //total = sum of (word*3 ^ (word >> 5)), skipping words that are
+  //negative as signed ints
+  Vector *acc = vec_getConstant(ms, 0, 32);
+  Vector *zero = vec_getConstant(ms, 0, 32);
+  Vector *three = vec_getConstant(ms, 3, 32);
+  Vector *five = vec_getConstant(ms, 5, 32);
+  for(i = 0; i < NUM_WORDS; i++) {
+    Vector *word = cMemory_load_le(ms, ARRAY_BASE + 4*i, 4);
+    expect(ms, vec_dup(ms, word), words[i], "load of word", i);
+    Vector *byte = cMemory_load_le(ms, ARRAY_BASE + 4*i + 1, 1);
+    expect(ms, byte, words[i] >> 8, "load of byte 1 of word", i);
+
+    Vector *negative = pINT_SLESS(ms, word, zero);
+    expect(ms, vec_dup(ms, negative), (int32_t)words[i] < 0, "sign of word", i);
+    if(!negative->conWord) {
+      Vector *tripled = pINT_MULT(ms, word, three);
+      Vector *shifted = pINT_RIGHT(ms, word, five);
+      Vector *mixed = pINT_XOR(ms, tripled, shifted);
+      Vector *next = pINT_ADD(ms, acc, mixed);
+      total += (words[i]*3) ^ (words[i] >> 5);
+      expect(ms, vec_dup(ms, next), total, "running total after word", i);
+      vec_release(ms, acc);
+      acc = next;
+      vec_release(ms, mixed);
+      vec_release(ms, shifted);
+      vec_release(ms, tripled);
+    }
+    vec_release(ms, negative);
+    vec_release(ms, word);
+  }
+
+  //Quotient and remainder, then the big-endian round trip
+  Vector *seven = vec_getConstant(ms, 7, 32);
+  expect(ms, pINT_DIV(ms, acc, seven), total / 7, "quotient", 0);
+  expect(ms, pINT_REM(ms, acc, seven), total % 7, "remainder", 0);
+  cMemory_store_be(ms, TOTAL_ADDR, acc, 4);
+  for(i = 0; i < 4; i++)
+    expect(ms, cMemory_load_le(ms, TOTAL_ADDR + i, 1), total >> (24 - 8*i), "big-endian byte", i);
+  expect(ms, cMemory_load_be(ms, TOTAL_ADDR, 4), total, "big-endian load", 0);
+
+  if(Gia_ManAndNum(ms->ntk) != 0) {
+    fprintf(stderr, "MISMATCH: %d AND nodes built in concrete-only mode\n", Gia_ManAndNum(ms->ntk));
+    exit(1);
+  }
+  fprintf(stdout, "concrete replay matches\n");
+
+  vec_release(ms, seven);
+  vec_release(ms, five);
+  vec_release(ms, three);
+  vec_release(ms, zero);
+  vec_release(ms, acc);
+  machine_state_free(ms);
+
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include <pcode_definitions.h>
+
+//Checks the constant-divisor lowerings (vec_divmod_const through
+//vec_divmod, and vec_sdivmod_const) against the restoring division circuit.
+//The reference divides the same input x by a second input y, and each
+//result is proven equal to it under the condition y == d, so the two sides
+//share no construction. The fused pINT_DIVREM and pINT_SDIVREM are checked
+//against the single-result operations and against the definition of
+//division: x == q*y + r with |r| < |y|, r taking the sign of x when signed,
+//and the division-by-zero results. Exits with 1 at the first mismatch.
+
+//Exits unless 'got' equals 'want' whenever y == d
+void check(machine_state *ms, Vector *got, Vector *want, Vector *y, Vector *d, const char *what, intmax_t divisor) {
+  push_condition(ms, vec_equal(ms, y, d), 1);
+  Gia_Lit_t same = vec_equal_SAT(ms, got, want, 1);
+  pop_condition(ms);
+  if(same == Gia_ManConst1Lit()) return;
+  fprintf(stderr, "MISMATCH: %ju bit %s by %jd\n", got->size, what, divisor);
+  exit(1);
+}
+
+//Exits unless 'ok' holds whenever the conditions pushed do
+void check_holds(machine_state *ms, Gia_Lit_t ok, const char *what, uintmax_t n) {
+  if(lit_equal_SAT(ms, ok, Gia_ManConst1Lit(), 1) == Gia_ManConst1Lit()) return;
+  fprintf(stderr, "MISMATCH: %ju bit %s\n", n, what);
+  exit(1);
+}
+
+//Exits unless 'got' and 'want' are the same function of the inputs
+void check_same(machine_state *ms, Vector *got, Vector *want, const char *what) {
+  if(vec_equal_SAT(ms, got, want, 1) == Gia_ManConst1Lit()) return;
+  fprintf(stderr, "MISMATCH: %ju bit %s\n", got->size, what);
+  exit(1);
+}
+
+//x == q*y + r
+Gia_Lit_t divides_back(machine_state *ms, Vector *x, Vector *y, Vector *q, Vector *r) {
+  Vector *product = vec_mult(ms, q, y);
+  Vector *back = vec_add(ms, product, r);
+  Gia_Lit_t ok = vec_equal(ms, back, x);
+  vec_release(ms, back);
+  vec_release(ms, product);
+  return ok;
+}
+
+void test_fused(machine_state *ms, uintmax_t n) {
+  Vector *q, *r;
+  Vector *x = vec_getInput(ms, n, "fx");
+  Vector *y = vec_getInput(ms, n, "fy");
+  Vector *zero = vec_getConstant(ms, 0, n);
+  Vector *ones = vec_getConstant(ms, ~((uintmax_t)0), n);
+  Gia_Lit_t y_zero = vec_equal(ms, y, zero);
+
+  //Unsigned
+  pINT_DIVREM(ms, x, y, &q, &r);
+  Vector *single = pINT_DIV(ms, x, y);
+  check_same(ms, q, single, "pINT_DIVREM quotient vs pINT_DIV");
+  vec_release(ms, single);
+  single = pINT_REM(ms, x, y);
+  check_same(ms, r, single, "pINT_DIVREM remainder vs pINT_REM");
+  vec_release(ms, single);
+
+  push_condition(ms, y_zero, 0);
+  check_holds(ms, divides_back(ms, x, y, q, r), "unsigned x == q*y + r", n);
+  check_holds(ms, vec_lessthan(ms, r, y), "unsigned r < y", n);
+  pop_condition(ms);
+  push_condition(ms, y_zero, 1);
+  check_holds(ms, vec_equal(ms, q, ones), "unsigned x/0 is all ones", n);
+  check_holds(ms, vec_equal(ms, r, x), "unsigned x%0 is x", n);
+  pop_condition(ms);
+  vec_release(ms, r);
+  vec_release(ms, q);
+
+  //Signed
+  pINT_SDIVREM(ms, x, y, &q, &r);
+  single = pINT_SDIV(ms, x, y);
+  check_same(ms, q, single, "pINT_SDIVREM quotient vs pINT_SDIV");
+  vec_release(ms, single);
+  single = pINT_SREM(ms, x, y);
+  check_same(ms, r, single, "pINT_SDIVREM remainder vs pINT_SREM");
+  vec_release(ms, single);
+
+  Vector *r_abs = vec_abs(ms, r);
+  Vector *y_abs = vec_abs(ms, y);
+  Gia_Lit_t same_sign = Abc_LitNot(Gia_ManHashXor(ms->ntk, vec_signed_lessthan(ms, r, zero), vec_signed_lessthan(ms, x, zero)));
+  push_condition(ms, y_zero, 0);
+  check_holds(ms, divides_back(ms, x, y, q, r), "signed x == q*y + r", n);
+  check_holds(ms, vec_lessthan(ms, r_abs, y_abs), "signed |r| < |y|", n);
+  check_holds(ms, Gia_ManHashOr(ms->ntk, vec_equal(ms, r, zero), same_sign), "signed r has the sign of x", n);
+  pop_condition(ms);
+  push_condition(ms, y_zero, 1);
+  check_holds(ms, vec_equal(ms, q, zero), "signed x/0 is zero", n);
+  check_holds(ms, vec_equal(ms, r, x), "signed x%0 is x", n);
+  pop_condition(ms);
+  vec_release(ms, y_abs);
+  vec_release(ms, r_abs);
+  vec_release(ms, r);
+  vec_release(ms, q);
+
+  vec_release(ms, ones);
+  vec_release(ms, zero);
+  vec_release(ms, y);
+  vec_release(ms, x);
+  fprintf(stdout, "%2ju bits: fused quotient and remainder match\n", n);
+}
+
+void test_unsigned(machine_state *ms, Vector *x, Vector *y, Vector *ref_q, Vector *ref_r, uintmax_t divisor) {
+  Vector *q, *r;
+  Vector *d = vec_getConstant(ms, int_zextend(divisor, x->size), x->size);
+  vec_divmod(ms, x, d, &q, &r);
+  check(ms, q, ref_q, y, d, "unsigned quotient", divisor);
+  check(ms, r, ref_r, y, d, "unsigned remainder", divisor);
+  vec_release(ms, r);
+  vec_release(ms, q);
+  vec_release(ms, d);
+}
+
+void test_signed(machine_state *ms, Vector *x, Vector *y, Vector *ref_q, Vector *ref_r, intmax_t divisor) {
+  Vector *q, *r;
+  Vector *d = vec_getConstant(ms, int_zextend((uintmax_t)divisor, x->size), x->size);
+  vec_sdivmod_const(ms, x, d, &q, &r);
+  check(ms, q, ref_q, y, d, "signed quotient", divisor);
+  check(ms, r, ref_r, y, d, "signed remainder", divisor);
+  vec_release(ms, r);
+  vec_release(ms, q);
+  vec_release(ms, d);
+}
+
+void test_width(machine_state *ms, uintmax_t n) {
+  uintmax_t i;
+  uintmax_t top = ((uintmax_t)1) << (n-1);
+  uintmax_t udivisors[] = {1, 2, 3, 7, 8, 10, top, top+1, 2*top-1};
+  intmax_t sdivisors[] = {1, -1, 2, -2, 3, -3, 7, -8, 10, (intmax_t)top-1, -(intmax_t)top};
+  Vector *ref_q, *ref_r;
+
+  Vector *x = vec_getInput(ms, n, "x");
+  Vector *y = vec_getInput(ms, n, "y");
+
+  vec_divmod(ms, x, y, &ref_q, &ref_r);
+  for(i = 0; i < sizeof(udivisors)/sizeof(udivisors[0]); i++)
+    test_unsigned(ms, x, y, ref_q, ref_r, udivisors[i]);
+  vec_release(ms, ref_r);
+  vec_release(ms, ref_q);
+
+  vec_sdivmod(ms, x, y, &ref_q, &ref_r);
+  for(i = 0; i < sizeof(sdivisors)/sizeof(sdivisors[0]); i++)
+    test_signed(ms, x, y, ref_q, ref_r, sdivisors[i]);
+  vec_release(ms, ref_r);
+  vec_release(ms, ref_q);
+
+  vec_release(ms, y);
+  vec_release(ms, x);
+  fprintf(stdout, "%2ju bits: constant divisors match\n", n);
+}
+
+//Concrete dividends fold through the same circuits, so wide divisors can be
+//checked against C's division where the SAT checks above do not reach
+void test_concrete(machine_state *ms, uintmax_t n) {
+  uintmax_t i, j;
+  uintmax_t mask = int_zextend(~((uintmax_t)0), n);
+  uintmax_t divisors[] = {3, 7, 10, 641, 1000000007, mask/3, mask-1, mask};
+  uintmax_t dividends[] = {0, 1, 9, 12345678901234567ULL, mask/7, mask-1, mask};
+  Vector *q, *r;
+
+  for(i = 0; i < sizeof(divisors)/sizeof(divisors[0]); i++) {
+    uintmax_t divisor = divisors[i] & mask;
+    Vector *d = vec_getConstant(ms, divisor, n);
+    for(j = 0; j < sizeof(dividends)/sizeof(dividends[0]); j++) {
+      uintmax_t dividend = dividends[j] & mask;
+      Vector *x = vec_getConstant(ms, dividend, n);
+      vec_divmod_const(ms, x, d, &q, &r);
+      if(q->isSymbolic || r->isSymbolic || q->conWord != dividend/divisor || r->conWord != dividend%divisor) {
+	fprintf(stderr, "MISMATCH: %ju bit %ju / %ju\n", n, dividend, divisor);
+	exit(1);
+      }
+      vec_release(ms, r);
+      vec_release(ms, q);
+      vec_release(ms, x);
+    }
+    vec_release(ms, d);
+  }
+  fprintf(stdout, "%2ju bits: concrete quotients and remainders match\n", n);
+}
+
+int main() {
+  machine_state *ms = machine_state_init("divide_test.c", 0, 12, 0x20000000, 32);
+
+  test_width(ms, 8);
+  test_width(ms, 16);
+  test_concrete(ms, 32);
+  test_concrete(ms, 64);
+  test_fused(ms, 8);
+
+  machine_state_free(ms);
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <pcode_definitions.h>
+
+//The term layer (ms->vec_lazy) must bit-blast to what eager mode builds.
+//build() feeds term operands to every operation that makes terms and to
+//the kernels that force them (constant division and remainder, the
+//barrel shifter, comparisons, the signed carry); with the memo cache off,
+//the eager run cannot reuse the lazy run's circuits. 12 bits is not a
+//power of two, so rotates go through the modulo reduction.
+
+#define NUM_VECS 24
+#define NUM_LITS 6
+
+const char *vec_names[] = {
+  "x+y", "x-y", "x*y", "ite(c,x,y)", "(x+y)*(x-y)", "ite(c,x+y,x-y)", "(x+y)+5",
+  "extract(x+y)", "trunc(x*y)", "cat(x+y,x-y)", "extract(cat(x+y,x))", "pSUBPIECE(x+y)",
+  "(x+y)/10", "(x+y)%10", "(x-y)/s-4", "(x-y)%s-4", "(x-y)/s7", "(x-y)%s7",
+  "rotateright(x+y,x-y)", "rotateleft(x*y,y)", "shiftleft(x*y,y)", "abs(x-y)", "-(x+y)", "pINT_SCARRY(x+y,y)"
+};
+const char *lit_names[] = {"x+y == y+x", "x+y < x-y", "x+y <s x-y", "x+y <=u x*y", "x+y <=s x*y", "carry(x+y,y)"};
+
+void build(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t c, Vector **vecs, Gia_Lit_t *lits) {
+  uintmax_t n = x->size;
+  Vector *q, *r;
+  vec_scope_begin(ms);
+
+  Vector *sum = vec_add(ms, x, y);
+  Vector *diff = vec_sub(ms, x, y);
+  Vector *prod = vec_mult(ms, x, y);
+  Vector *five = vec_getConstant(ms, 5, n);
+  Vector *ten = vec_getConstant(ms, 10, n);
+  Vector *minus_four = vec_getConstant(ms, int_zextend(-(uintmax_t)4, n), n);
+  Vector *seven = vec_getConstant(ms, 7, n);
+  Vector *high = vec_cat(ms, sum, x);
+
+  vecs[0] = vec_scope_keep(ms, vec_dup(ms, sum));
+  vecs[1] = vec_scope_keep(ms, vec_dup(ms, diff));
+  vecs[2] = vec_scope_keep(ms, vec_dup(ms, prod));
+  vecs[3] = vec_scope_keep(ms, vec_ite(ms, c, x, y));
+  vecs[4] = vec_scope_keep(ms, vec_mult(ms, sum, diff));
+  vecs[5] = vec_scope_keep(ms, vec_ite(ms, c, sum, diff));
+  vecs[6] = vec_scope_keep(ms, vec_add(ms, sum, five));
+  vecs[7] = vec_scope_keep(ms, vec_extract(ms, sum, 1, n-2));
+  vecs[8] = vec_scope_keep(ms, vec_trunc(ms, prod, n/2));
+  vecs[9] = vec_scope_keep(ms, vec_cat(ms, sum, diff));
+  vecs[10] = vec_scope_keep(ms, vec_extract(ms, high, n, n));
+  vecs[11] = vec_scope_keep(ms, pSUBPIECE(ms, sum, n/16, 1));
+  vec_divmod(ms, sum, ten, &q, &r);
+  vecs[12] = vec_scope_keep(ms, q);
+  vecs[13] = vec_scope_keep(ms, r);
+  vec_sdivmod_const(ms, diff, minus_four, &q, &r);
+  vecs[14] = vec_scope_keep(ms, q);
+  vecs[15] = vec_scope_keep(ms, r);
+  vec_sdivmod_const(ms, diff, seven, &q, &r);
+  vecs[16] = vec_scope_keep(ms, q);
+  vecs[17] = vec_scope_keep(ms, r);
+  vecs[18] = vec_scope_keep(ms, vec_rotateright(ms, sum, diff));
+  vecs[19] = vec_scope_keep(ms, vec_rotateleft(ms, prod, y));
+  vecs[20] = vec_scope_keep(ms, vec_shiftleft(ms, prod, y));
+  vecs[21] = vec_scope_keep(ms, vec_abs(ms, diff));
+  vecs[22] = vec_scope_keep(ms, vec_negate(ms, sum));
+  vecs[23] = vec_scope_keep(ms, pINT_SCARRY(ms, sum, y));
+
+  Vector *commuted = vec_add(ms, y, x);
+  lits[0] = vec_equal(ms, sum, commuted);
+  lits[1] = vec_lessthan(ms, sum, diff);
+  lits[2] = vec_signed_lessthan(ms, sum, diff);
+  lits[3] = vec_compare(ms, sum, prod, VEC_CMP_ULE);
+  lits[4] = vec_compare(ms, sum, prod, VEC_CMP_SLE);
+  lits[5] = vec_carry(ms, sum, y);
+
+  vec_scope_end(ms);
+}
+
+void test(machine_state *ms, uintmax_t n) {
+  uintmax_t i, j;
+  Vector *lazy[NUM_VECS], *eager[NUM_VECS];
+  Gia_Lit_t lazy_lits[NUM_LITS], eager_lits[NUM_LITS];
+  Vector *x = vec_getInput(ms, n, "x");
+  Vector *y = vec_getInput(ms, n, "y");
+  Vector *cond = vec_getInput(ms, 1, "c");
+  Gia_Lit_t c = cond->symWord[0];
+
+  ms->vec_lazy = 1;
+  build(ms, x, y, c, lazy, lazy_lits);
+  ms->vec_lazy = 0;
+  build(ms, x, y, c, eager, eager_lits);
+
+  i = vec_find_unequal(ms, lazy, eager, NUM_VECS);
+  j = lit_find_unequal(ms, lazy_lits, eager_lits, NUM_LITS);
+  if(i < NUM_VECS || j < NUM_LITS) {
+    fprintf(stderr, "MISMATCH: %ju bit %s differs in lazy mode\n", n, (i < NUM_VECS) ? vec_names[i] : lit_names[j]);
+    exit(1);
+  }
+
+  for(i = 0; i < NUM_VECS; i++) {
+    vec_release(ms, eager[i]);
+    vec_release(ms, lazy[i]);
+  }
+
+  vec_release(ms, cond);
+  vec_release(ms, y);
+  vec_release(ms, x);
+  fprintf(stdout, "%2ju bits: lazy results match\n", n);
+}
+
+//heap_offset holds a term across a collection, as after a malloc of a
+//symbolic size in lazy mode; it is a root, so it is forced and kept
+void test_gc(machine_state *ms) {
+  Vector *size = vec_getInput(ms, ms->heap_offset->size, "size");
+  ms->vec_lazy = 1;
+  Vector *offset = vec_add(ms, ms->heap_offset, size);
+  ms->vec_lazy = 0;
+  Vector *want = vec_add(ms, ms->heap_offset, size);
+  vec_release(ms, ms->heap_offset);
+  ms->heap_offset = offset;
+
+  garbage_collect_ntk(ms, Gia_ManConst1Lit(), 1);
+  if(ms->heap_offset->term != 0 || vec_equal_SAT(ms, ms->heap_offset, want, 1) != Gia_ManConst1Lit()) {
+    fprintf(stderr, "MISMATCH: heap_offset differs after a collection in lazy mode\n");
+    exit(1);
+  }
+
+  vec_release(ms, want);
+  vec_release(ms, size);
+  fprintf(stdout, "heap_offset survives a collection\n");
+}
+
+int main() {
+  uintmax_t i;
+  uintmax_t widths[] = {8, 12, 16};
+  machine_state *ms = machine_state_init("lazy_test.c", 0, 12, 0x20000000, 32);
+  ms->vec_memo = 0;
+
+  for(i = 0; i < sizeof(widths)/sizeof(widths[0]); i++)
+    test(ms, widths[i]);
+  test_gc(ms);
+
+  machine_state_free(ms);
+
+  return 0;
+}
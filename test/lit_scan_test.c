@@ -0,0 +1,106 @@
+#include <pcode_definitions.h>
+
+//Checks the literal-array scans of src/lit_scan.c against plain loops, on
+//random arrays of every length up to MAX_LEN and at every start offset
+//below 8, so that each SIMD kernel also runs with a scalar tail. The
+//kernels are picked when lit_scan.c is compiled: 'make lit_scan_test'
+//checks the library's copy, and lit_scan_test_avx2 and lit_scan_test_sse41
+//compile it in with -mavx2 and -msse4.1. Exits with 1 at the first
+//mismatch.
+
+#define MAX_LEN 100
+#define MAX_OFFSET 8
+#define NUM_TRIALS 64
+
+uintmax_t xorshift(uintmax_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+//Mostly constants, so that the all-constant and pack cases are common
+Gia_Lit_t random_lit(uintmax_t *state) {
+  uintmax_t r = xorshift(state);
+  if((r & 3) != 0) return (Gia_Lit_t)((r >> 2) & 1);
+  return (Gia_Lit_t)((r >> 2) & 0xffff);
+}
+
+//b is a, except now and then a literal or its complement
+void perturb(uintmax_t *state, Gia_Lit_t *b, const Gia_Lit_t *a, uintmax_t n) {
+  uintmax_t i;
+  for(i = 0; i < n; i++) {
+    uintmax_t r = xorshift(state) % (4*n + 1);
+    b[i] = a[i];
+    if(r == 0) b[i] = a[i] ^ 1;
+    else if(r == 1) b[i] = a[i] + 2;
+  }
+}
+
+void fail(const char *kernel, uintmax_t n, uintmax_t offset) {
+  fprintf(stderr, "MISMATCH: %s differs from the plain loop at length %ju, offset %ju\n", kernel, n, offset);
+  exit(1);
+}
+
+void test(uintmax_t *state, uintmax_t n, uintmax_t offset) {
+  uintmax_t i;
+  Gia_Lit_t a[MAX_LEN + MAX_OFFSET], b[MAX_LEN + MAX_OFFSET], u[WORD_BITS + MAX_OFFSET];
+  Gia_Lit_t *x = a + offset, *y = b + offset;
+  memset(a, 0, sizeof(a));
+  memset(b, 0, sizeof(b));
+
+  for(i = 0; i < n; i++)
+    x[i] = random_lit(state);
+  perturb(state, y, x, n);
+
+  uint8_t all_const = 1, equal = 1, complement = 0;
+  for(i = 0; i < n; i++) {
+    if((x[i] >> 1) != 0) all_const = 0;
+    if(x[i] != y[i]) equal = 0;
+    if((x[i] ^ y[i]) == 1) complement = 1;
+  }
+  if(lits_all_const(x, n) != all_const) fail("lits_all_const", n, offset);
+  if(lits_equal(x, y, n) != equal) fail("lits_equal", n, offset);
+  if(lits_equal(x, x, n) != 1) fail("lits_equal", n, offset);
+  if(lits_any_complement(x, y, n) != complement) fail("lits_any_complement", n, offset);
+
+  if(n > WORD_BITS) return;
+
+  uintmax_t mask, value, want_mask = 0, want_value = 0;
+  for(i = 0; i < n; i++) {
+    if((x[i] >> 1) == 0) want_mask |= ((uintmax_t)1) << i;
+    if(x[i] == 1) want_value |= ((uintmax_t)1) << i;
+  }
+  lits_pack(x, n, &mask, &value);
+  if(mask != want_mask || value != want_value) fail("lits_pack", n, offset);
+
+  //Guard literals on both sides catch a store outside [0, n)
+  uintmax_t word = xorshift(state);
+  for(i = 0; i < WORD_BITS + MAX_OFFSET; i++)
+    u[i] = 2;
+  lits_unpack(u + offset, n, word);
+  for(i = 0; i < WORD_BITS + MAX_OFFSET; i++) {
+    Gia_Lit_t want = (i >= offset && i < offset + n) ? (Gia_Lit_t)((word >> (i - offset)) & 1) : 2;
+    if(u[i] != want) fail("lits_unpack", n, offset);
+  }
+}
+
+int main() {
+  uintmax_t n, offset, trial;
+  uintmax_t state = 0x9e3779b97f4a7c15ULL;
+
+  for(n = 0; n <= MAX_LEN; n++)
+    for(offset = 0; offset < MAX_OFFSET; offset++)
+      for(trial = 0; trial < NUM_TRIALS; trial++)
+	test(&state, n, offset);
+
+#if defined(__AVX2__)
+  fprintf(stdout, "AVX2 literal scans match\n");
+#elif defined(__SSE4_1__)
+  fprintf(stdout, "SSE4.1 literal scans match\n");
+#else
+  fprintf(stdout, "Literal scans match\n");
+#endif
+
+  return 0;
+}
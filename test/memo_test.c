@@ -0,0 +1,130 @@
+#include <pcode_definitions.h>
+
+//A memo cache (ms->vec_memo) hit under the wrong key hands back another
+//operation's literals. The workload below repeats operands that differ
+//only in a constant, in width or in order, and runs under every adder and
+//multiplier, whose circuits the key must also tell apart. Rounds after
+//the first must hit and still match the uncached results. A garbage
+//collection in between must empty the cache, so that no entry outlives
+//the literals it recorded.
+
+#define NUM_VECS 10
+#define NUM_LITS 5
+#define NUM_ROUNDS 2 //Every round after the first should hit
+
+const char *vec_names[] = {"x+y", "y+x", "x+5", "x+6", "x-y", "y-x", "x-5", "x*y", "x*5", "lo(x)+lo(y)"};
+const char *lit_names[] = {"carry(x,y)", "carry(y,x)", "x<y", "x<s y", "x==y"};
+
+void workload(machine_state *ms, Vector *x, Vector *y, Vector **vecs, Gia_Lit_t *lits) {
+  Vector *five = vec_getConstant(ms, 5, x->size);
+  Vector *six = vec_getConstant(ms, 6, x->size);
+  Vector *lo_x = vec_extract(ms, x, 0, x->size/2);
+  Vector *lo_y = vec_extract(ms, y, 0, y->size/2);
+
+  vecs[0] = vec_add(ms, x, y);
+  vecs[1] = vec_add(ms, y, x);
+  vecs[2] = vec_add(ms, x, five);
+  vecs[3] = vec_add(ms, x, six);
+  vecs[4] = vec_sub(ms, x, y);
+  vecs[5] = vec_sub(ms, y, x);
+  vecs[6] = vec_sub(ms, x, five);
+  vecs[7] = vec_mult(ms, x, y);
+  vecs[8] = vec_mult(ms, x, five);
+  vecs[9] = vec_add(ms, lo_x, lo_y);
+  lits[0] = vec_carry(ms, x, y);
+  lits[1] = vec_carry(ms, y, x);
+  lits[2] = vec_lessthan(ms, x, y);
+  lits[3] = vec_signed_lessthan(ms, x, y);
+  lits[4] = vec_equal(ms, x, y);
+
+  vec_release(ms, lo_y);
+  vec_release(ms, lo_x);
+  vec_release(ms, six);
+  vec_release(ms, five);
+}
+
+void release_all(machine_state *ms, Vector **vecs) {
+  uintmax_t i;
+  for(i = 0; i < NUM_VECS; i++)
+    vec_release(ms, vecs[i]);
+}
+
+void check(machine_state *ms, Vector **got, Gia_Lit_t *got_lits, Vector **want, Gia_Lit_t *want_lits, const char *config) {
+  uintmax_t i = vec_find_unequal(ms, got, want, NUM_VECS);
+  uintmax_t j = lit_find_unequal(ms, got_lits, want_lits, NUM_LITS);
+  if(i == NUM_VECS && j == NUM_LITS) return;
+  fprintf(stderr, "MISMATCH: %s %s differs with the memo cache on\n", config, (i < NUM_VECS) ? vec_names[i] : lit_names[j]);
+  exit(1);
+}
+
+void rounds(machine_state *ms, Vector *x, Vector *y, const char *config) {
+  uintmax_t round;
+  Vector *cached[NUM_VECS], *plain[NUM_VECS];
+  Gia_Lit_t cached_lits[NUM_LITS], plain_lits[NUM_LITS];
+
+  ms->vec_memo = 0;
+  workload(ms, x, y, plain, plain_lits);
+
+  ms->vec_memo = 1;
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    uintmax_t hits = ms->vec_memo_hits;
+    workload(ms, x, y, cached, cached_lits);
+    if(round > 0 && ms->vec_memo_hits == hits) {
+      fprintf(stderr, "MISMATCH: %s never hit the memo cache\n", config);
+      exit(1);
+    }
+    check(ms, cached, cached_lits, plain, plain_lits, config);
+    release_all(ms, cached);
+  }
+
+  release_all(ms, plain);
+}
+
+void test(machine_state *ms, uintmax_t width, uint8_t adder, uint8_t multiplier) {
+  char config[64];
+  uintmax_t bytes = width / BITS_IN_BYTE;
+  Vector *x = vec_getInput(ms, width, "x");
+  Vector *y = vec_getInput(ms, width, "y");
+
+  snprintf(config, sizeof(config), "%ju bit adder %u multiplier %u", width, adder, multiplier);
+  ms->vec_adder = adder;
+  ms->vec_multiplier = multiplier;
+  rounds(ms, x, y, config);
+
+  //Collect with x and y rooted in memory, then run the rounds again on
+  //whatever literals they have afterwards
+  uintmax_t flushes = ms->vec_memo_flushes;
+  cMemory_store_le(ms, 0x0, x, bytes);
+  cMemory_store_le(ms, bytes, y, bytes);
+  vec_release(ms, y);
+  vec_release(ms, x);
+  garbage_collect_ntk(ms, Gia_ManConst1Lit(), 1);
+  if(ms->vec_memo_flushes == flushes) {
+    fprintf(stderr, "MISMATCH: %s memo cache survived a collection\n", config);
+    exit(1);
+  }
+  x = cMemory_load_le(ms, 0x0, bytes);
+  y = cMemory_load_le(ms, bytes, bytes);
+  rounds(ms, x, y, config);
+
+  vec_release(ms, y);
+  vec_release(ms, x);
+}
+
+int main() {
+  uintmax_t i;
+  uint8_t adder, multiplier;
+  uintmax_t widths[] = {8, 16};
+  machine_state *ms = machine_state_init("memo_test.c", 0, 12, 0x20000000, 32);
+
+  for(i = 0; i < sizeof(widths)/sizeof(widths[0]); i++) {
+    for(adder = VEC_ADDER_RIPPLE; adder <= VEC_ADDER_BRENT_KUNG; adder++)
+      for(multiplier = VEC_MULT_ARRAY; multiplier <= VEC_MULT_WALLACE; multiplier++)
+	test(ms, widths[i], adder, multiplier);
+    fprintf(stdout, "%2ju bits: memoized results match\n", widths[i]);
+  }
+
+  machine_state_free(ms);
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <pcode_definitions.h>
+
+//Compares the shift-add array multiplier with the Wallace tree
+//(ms->vec_multiplier). For each width it multiplies two fresh inputs and
+//reports the new AND nodes, the deepest product bit and the time the SAT
+//sweeper spends checking whether the product can equal an odd constant.
+//Products up to PROVE_WIDTH bits are proven equal to the array
+//multiplier's; wider ones are checked at random input values, since a
+//miter of two wide multipliers does not finish.
+
+#define PROVE_WIDTH 8
+#define NUM_SAMPLES 16
+
+const char *mult_names[] = {"array", "wallace"};
+
+uintmax_t xorshift(uintmax_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+//Rebuild the product with the array multiplier and prove it equal, or
+//check that it is the concrete product at sampled inputs
+uint8_t product_matches(machine_state *ms, Vector *x, Vector *y, Vector *prod, uint8_t multiplier) {
+  uintmax_t i, state = 0x9e3779b97f4a7c15ULL;
+  uint8_t match = 1;
+
+  if(x->size <= PROVE_WIDTH) {
+    ms->vec_multiplier = VEC_MULT_ARRAY;
+    Vector *ref = vec_mult(ms, x, y);
+    ms->vec_multiplier = multiplier;
+    match = vec_equal_SAT(ms, prod, ref, 1) == Gia_ManConst1Lit();
+    vec_release(ms, ref);
+    return match;
+  }
+
+  for(i = 0; i < NUM_SAMPLES && match; i++) {
+    Vector *a = vec_getConstant(ms, int_zextend(xorshift(&state), x->size), x->size);
+    Vector *b = vec_getConstant(ms, int_zextend(xorshift(&state), x->size), x->size);
+    Vector *ab = vec_mult(ms, a, b);
+    Gia_Lit_t at_sample = Gia_ManHashAnd(ms->ntk, vec_equal(ms, x, a), vec_equal(ms, y, b));
+    Gia_Lit_t wrong = Gia_ManHashAnd(ms->ntk, at_sample, Abc_LitNot(vec_equal(ms, prod, ab)));
+    match = lit_equal_SAT(ms, wrong, Gia_ManConst0Lit(), 1) == Gia_ManConst1Lit();
+    vec_release(ms, ab);
+    vec_release(ms, b);
+    vec_release(ms, a);
+  }
+  return match;
+}
+
+void bench(machine_state *ms, uintmax_t width, uint8_t multiplier) {
+  struct timeval start, end;
+  ms->vec_multiplier = multiplier;
+
+  Vector *x = vec_getInput(ms, width, "x");
+  Vector *y = vec_getInput(ms, width, "y");
+
+  int ands = Gia_ManAndNum(ms->ntk);
+  Vector *prod = vec_mult(ms, x, y);
+  ands = Gia_ManAndNum(ms->ntk) - ands;
+
+  Gia_ManLevelNum(ms->ntk);
+  int depth = vec_depth(ms, prod);
+
+  Vector *target = vec_getConstant(ms, 0x9e3779b97f4a7c15ULL, width);
+  gettimeofday(&start, NULL);
+  vec_equal_SAT(ms, prod, target, 1);
+  gettimeofday(&end, NULL);
+  double sat_ms = (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_usec - start.tv_usec)/1000.0;
+
+  fprintf(stdout, "%2ju bits %-8s ANDs=%-6d depth=%-4d SAT=%.2fms\n",
+	  width, mult_names[multiplier], ands, depth, sat_ms);
+
+  if(!product_matches(ms, x, y, prod, multiplier)) {
+    fprintf(stderr, "MISMATCH: %ju bit %s product is wrong\n", width, mult_names[multiplier]);
+    exit(1);
+  }
+
+  vec_release(ms, target);
+  vec_release(ms, prod);
+  vec_release(ms, y);
+  vec_release(ms, x);
+}
+
+int main() {
+  uintmax_t width;
+  uint8_t multiplier;
+  machine_state *ms = machine_state_init("mult_bench.c", 0, 12, 0x20000000, 32);
+
+  for(width = 8; width <= 64; width *= 2)
+    for(multiplier = VEC_MULT_ARRAY; multiplier <= VEC_MULT_WALLACE; multiplier++)
+      bench(ms, width, multiplier);
+
+  machine_state_free(ms);
+
+  return 0;
+}
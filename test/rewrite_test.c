@@ -0,0 +1,222 @@
+#include <pcode_definitions.h>
+
+//Checks the word-level rewriter (ms->vec_rules) on expressions that one
+//rule each should simplify. With every rule on, each result must be the
+//simplified form itself: a constant, an operand, or the shorter sum or
+//slice with the same literals or term. With the rules off, eagerly and
+//without the memo cache, the same expressions are built gate by gate and
+//the rewritten results must be equal to them. The slice rules and the
+//self rules on terms only apply in lazy mode, so that part of the
+//rewritten run builds terms.
+
+#define NUM_VECS 30
+#define NUM_LITS 6
+
+const char *vec_names[] = {
+  "x-x", "x^x", "x&x", "x|x", "ite(c,x,x)",
+  "x*0", "0*x", "x*1", "x&0", "x&ones", "x|0", "x|ones", "x+0", "x-0", "x^0",
+  "(x+3)+4", "(x+3)+(-3)", "((x+1)+1)+1", "x-5", "(x-5)+5",
+  "s-s", "ite(c,s,s)",
+  "trunc(zext(s))", "extract(zext(s))", "extract(extract(s))", "extract(cat(s,d))", "extract(cat(s,d)) low",
+  "cat(extract(s),extract(s))", "extract(zext(s)) across", "extract(extract(s)) twice"
+};
+const char *lit_names[] = {"x==x", "x<x", "x<s x", "x<=u x", "s<s", "s==s"};
+
+void build(machine_state *ms, Vector *x, Vector *y, Gia_Lit_t c, uint8_t lazy, Vector **vecs, Gia_Lit_t *lits) {
+  uintmax_t n = x->size;
+  uintmax_t ones = int_zextend(~((uintmax_t)0), n);
+  vec_scope_begin(ms);
+
+  Vector *zero = vec_getConstant(ms, 0, n);
+  Vector *one = vec_getConstant(ms, 1, n);
+  Vector *all = vec_getConstant(ms, ones, n);
+  Vector *three = vec_getConstant(ms, 3, n);
+  Vector *four = vec_getConstant(ms, 4, n);
+  Vector *five = vec_getConstant(ms, 5, n);
+  Vector *minus_three = vec_getConstant(ms, int_zextend(-(uintmax_t)3, n), n);
+
+  //Self
+  vecs[0] = vec_scope_keep(ms, vec_sub(ms, x, x));
+  vecs[1] = vec_scope_keep(ms, vec_xor(ms, x, x));
+  vecs[2] = vec_scope_keep(ms, vec_and(ms, x, x));
+  vecs[3] = vec_scope_keep(ms, vec_or(ms, x, x));
+  vecs[4] = vec_scope_keep(ms, vec_ite(ms, c, x, x));
+  lits[0] = vec_equal(ms, x, x);
+  lits[1] = vec_lessthan(ms, x, x);
+  lits[2] = vec_signed_lessthan(ms, x, x);
+  lits[3] = vec_compare(ms, x, x, VEC_CMP_ULE);
+
+  //Unit
+  vecs[5] = vec_scope_keep(ms, vec_mult(ms, x, zero));
+  vecs[6] = vec_scope_keep(ms, vec_mult(ms, zero, x));
+  vecs[7] = vec_scope_keep(ms, vec_mult(ms, x, one));
+  vecs[8] = vec_scope_keep(ms, vec_and(ms, x, zero));
+  vecs[9] = vec_scope_keep(ms, vec_and(ms, x, all));
+  vecs[10] = vec_scope_keep(ms, vec_or(ms, x, zero));
+  vecs[11] = vec_scope_keep(ms, vec_or(ms, x, all));
+  vecs[12] = vec_scope_keep(ms, vec_add(ms, x, zero));
+  vecs[13] = vec_scope_keep(ms, vec_sub(ms, x, zero));
+  vecs[14] = vec_scope_keep(ms, vec_xor(ms, x, zero));
+
+  //Offset
+  Vector *x3 = vec_add(ms, x, three);
+  Vector *x1 = vec_add(ms, x, one);
+  Vector *x11 = vec_add(ms, x1, one);
+  vecs[15] = vec_scope_keep(ms, vec_add(ms, x3, four));
+  vecs[16] = vec_scope_keep(ms, vec_add(ms, x3, minus_three));
+  vecs[17] = vec_scope_keep(ms, vec_add(ms, x11, one));
+  vecs[18] = vec_scope_keep(ms, vec_sub(ms, x, five));
+  vecs[19] = vec_scope_keep(ms, vec_add(ms, vecs[18], five));
+
+  //Terms
+  ms->vec_lazy = lazy;
+  Vector *s = vec_add(ms, x, y);
+  Vector *d = vec_sub(ms, x, y);
+  Vector *wide = vec_zextend(ms, s, 2*n);
+  Vector *both = vec_cat(ms, s, d);
+  Vector *inner = vec_extract(ms, s, 1, n-2);
+  Vector *lo = vec_extract(ms, s, 0, n/2);
+  Vector *hi = vec_extract(ms, s, n/2, n/2);
+  vecs[20] = vec_scope_keep(ms, vec_sub(ms, s, s));
+  vecs[21] = vec_scope_keep(ms, vec_ite(ms, c, s, s));
+  vecs[22] = vec_scope_keep(ms, vec_trunc(ms, wide, n));
+  vecs[23] = vec_scope_keep(ms, vec_extract(ms, wide, n, n/2));
+  vecs[24] = vec_scope_keep(ms, vec_extract(ms, inner, 1, n-4));
+  vecs[25] = vec_scope_keep(ms, vec_extract(ms, both, n, n));
+  vecs[26] = vec_scope_keep(ms, vec_extract(ms, both, 1, n-1));
+  vecs[27] = vec_scope_keep(ms, vec_cat(ms, hi, lo));
+  vecs[28] = vec_scope_keep(ms, vec_extract(ms, wide, n/2, n));
+  vecs[29] = vec_scope_keep(ms, vec_extract(ms, vecs[24], 1, n-6));
+  lits[4] = vec_lessthan(ms, s, s);
+  lits[5] = vec_equal(ms, s, s);
+  ms->vec_lazy = 0;
+
+  vec_scope_end(ms);
+}
+
+//What each rewritten result must be, built with the rules on; NULL where
+//no rule applies
+void expected(machine_state *ms, Vector *x, Vector *y, Vector **vecs, Gia_Lit_t *lits) {
+  uintmax_t i, n = x->size;
+  uintmax_t ones = int_zextend(~((uintmax_t)0), n);
+  uint8_t lit_values[NUM_LITS] = {1, 0, 0, 1, 0, 1};
+
+  Vector *zero = vec_getConstant(ms, 0, n);
+  vecs[0] = zero;
+  vecs[1] = zero;
+  for(i = 2; i <= 4; i++) vecs[i] = x;
+  vecs[5] = zero;
+  vecs[6] = zero;
+  vecs[7] = x;
+  vecs[8] = zero;
+  vecs[9] = x;
+  vecs[10] = x;
+  vecs[11] = vec_getConstant(ms, ones, n);
+  for(i = 12; i <= 14; i++) vecs[i] = x;
+  vecs[15] = vec_add(ms, x, vec_getConstant(ms, 7, n));
+  vecs[16] = x;
+  vecs[17] = vec_add(ms, x, vec_getConstant(ms, 3, n));
+  vecs[18] = vec_add(ms, x, vec_getConstant(ms, int_zextend(-(uintmax_t)5, n), n));
+  vecs[19] = x;
+
+  ms->vec_lazy = 1;
+  Vector *s = vec_add(ms, x, y);
+  Vector *d = vec_sub(ms, x, y);
+  vecs[20] = zero;
+  vecs[21] = s;
+  vecs[22] = s;
+  vecs[23] = vec_getConstant(ms, 0, n/2);
+  vecs[24] = vec_extract(ms, s, 2, n-4);
+  vecs[25] = s;
+  vecs[26] = vec_extract(ms, d, 1, n-1);
+  vecs[27] = s;
+  vecs[28] = NULL;
+  vecs[29] = vec_extract(ms, s, 3, n-6);
+  ms->vec_lazy = 0;
+
+  for(i = 0; i < NUM_LITS; i++)
+    lits[i] = lit_values[i] ? Gia_ManConst1Lit() : Gia_ManConst0Lit();
+}
+
+//'got' is 'want' itself rather than a circuit that computes it
+uint8_t identical(machine_state *ms, Vector *got, Vector *want) {
+  if(want->term == 0 && !want->isSymbolic) {
+    vec_force(ms, got);
+    return !got->isSymbolic && vec_con_equal(got, want);
+  }
+  return vec_same(ms, got, want);
+}
+
+void test(machine_state *ms, uintmax_t n) {
+  uintmax_t i;
+  uintmax_t hits[VEC_RULE_COUNT];
+  Vector *rewritten[NUM_VECS], *plain[NUM_VECS], *want[NUM_VECS];
+  Gia_Lit_t rewritten_lits[NUM_LITS], plain_lits[NUM_LITS], want_lits[NUM_LITS];
+  Vector *x = vec_getInput(ms, n, "x");
+  Vector *y = vec_getInput(ms, n, "y");
+  Vector *cond = vec_getInput(ms, 1, "c");
+  Gia_Lit_t c = cond->symWord[0];
+
+  ms->vec_rules = 0;
+  ms->vec_memo = 0;
+  build(ms, x, y, c, 0, plain, plain_lits);
+
+  //The memo cache stays off, as the offset rule must not depend on it
+  ms->vec_rules = VEC_RULES_ALL;
+  memcpy(hits, ms->vec_rule_hits, sizeof(hits));
+  build(ms, x, y, c, 1, rewritten, rewritten_lits);
+  for(i = 0; i < VEC_RULE_COUNT; i++) {
+    if(ms->vec_rule_hits[i] > hits[i]) continue;
+    fprintf(stderr, "MISMATCH: %ju bit rule %ju never fired\n", n, i);
+    exit(1);
+  }
+
+  vec_scope_begin(ms);
+  expected(ms, x, y, want, want_lits);
+  for(i = 0; i < NUM_VECS; i++) {
+    if(want[i] == NULL || identical(ms, rewritten[i], want[i])) continue;
+    fprintf(stderr, "MISMATCH: %ju bit %s was not simplified\n", n, vec_names[i]);
+    exit(1);
+  }
+  vec_scope_end(ms);
+  for(i = 0; i < NUM_LITS; i++) {
+    if(rewritten_lits[i] == want_lits[i]) continue;
+    fprintf(stderr, "MISMATCH: %ju bit %s was not simplified\n", n, lit_names[i]);
+    exit(1);
+  }
+
+  i = vec_find_unequal(ms, rewritten, plain, NUM_VECS);
+  if(i < NUM_VECS) {
+    fprintf(stderr, "MISMATCH: %ju bit %s differs when rewritten\n", n, vec_names[i]);
+    exit(1);
+  }
+  i = lit_find_unequal(ms, rewritten_lits, plain_lits, NUM_LITS);
+  if(i < NUM_LITS) {
+    fprintf(stderr, "MISMATCH: %ju bit %s differs when rewritten\n", n, lit_names[i]);
+    exit(1);
+  }
+
+  ms->vec_memo = 1;
+  for(i = 0; i < NUM_VECS; i++) {
+    vec_release(ms, plain[i]);
+    vec_release(ms, rewritten[i]);
+  }
+
+  vec_release(ms, cond);
+  vec_release(ms, y);
+  vec_release(ms, x);
+  fprintf(stdout, "%2ju bits: rewritten results match\n", n);
+}
+
+int main() {
+  uintmax_t i;
+  uintmax_t widths[] = {8, 16};
+  machine_state *ms = machine_state_init("rewrite_test.c", 0, 12, 0x20000000, 32);
+
+  for(i = 0; i < sizeof(widths)/sizeof(widths[0]); i++)
+    test(ms, widths[i]);
+
+  machine_state_free(ms);
+
+  return 0;
+}
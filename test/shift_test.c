@@ -0,0 +1,72 @@
+#include <pcode_definitions.h>
+
+//Checks the barrel shifter behind the shifts and rotates with a symbolic
+//amount. The reference is a mux over every amount value, each arm built by
+//the same operation with a concrete amount. Shifts are tried with amounts
+//narrower than, as wide as and far wider (32 bits) than the stages need;
+//rotates at power-of-two widths and at widths that are not, where the
+//amount is reduced modulo the width. Exits with 1 at the first mismatch.
+
+typedef Vector *(*shift_op)(machine_state *ms, Vector *x, Vector *amount);
+
+const char *shift_names[] = {"shiftright", "signedshiftright", "shiftleft", "rotateright", "rotateleft"};
+shift_op shift_ops[] = {vec_shiftright, vec_signedshiftright, vec_shiftleft, vec_rotateright, vec_rotateleft};
+#define NUM_SHIFTS 3 //shift_ops[0..2] are shifts, the rest rotates
+#define NUM_OPS 5
+
+//op(x, amount) as a mux over the amounts below count-1, with op(x, count-1)
+//for every larger amount
+Vector *reference(machine_state *ms, shift_op op, Vector *x, Vector *amount, uintmax_t count) {
+  uintmax_t v;
+  Vector *c = vec_getConstant(ms, count-1, amount->size);
+  Vector *ref = op(ms, x, c);
+  vec_release(ms, c);
+  for(v = 0; v+1 < count; v++) {
+    c = vec_getConstant(ms, v, amount->size);
+    Vector *arm = op(ms, x, c);
+    Vector *next = vec_ite(ms, vec_equal(ms, amount, c), arm, ref);
+    vec_release(ms, arm);
+    vec_release(ms, ref);
+    vec_release(ms, c);
+    ref = next;
+  }
+  return ref;
+}
+
+//'count' must cover every amount whose result differs from the next one's
+void test(machine_state *ms, uintmax_t op, uintmax_t width, uintmax_t amount_width, uintmax_t count) {
+  Vector *x = vec_getInput(ms, width, "x");
+  Vector *amount = vec_getInput(ms, amount_width, "amount");
+
+  Vector *got = shift_ops[op](ms, x, amount);
+  Vector *want = reference(ms, shift_ops[op], x, amount, count);
+  if(vec_equal_SAT(ms, got, want, 1) != Gia_ManConst1Lit()) {
+    fprintf(stderr, "MISMATCH: %s of %ju bits by a %ju bit amount\n", shift_names[op], width, amount_width);
+    exit(1);
+  }
+
+  vec_release(ms, want);
+  vec_release(ms, got);
+  vec_release(ms, amount);
+  vec_release(ms, x);
+}
+
+int main() {
+  uintmax_t i, op;
+  uintmax_t widths[] = {1, 5, 7, 8, 12, 16};
+  machine_state *ms = machine_state_init("shift_test.c", 0, 12, 0x20000000, 32);
+
+  for(i = 0; i < sizeof(widths)/sizeof(widths[0]); i++) {
+    for(op = 0; op < NUM_OPS; op++) {
+      test(ms, op, widths[i], 3, 8);      //Every amount
+      test(ms, op, widths[i], 8, 256);    //Every amount
+      if(op < NUM_SHIFTS)
+	test(ms, op, widths[i], 32, 256); //Amounts from 255 up all shift everything out
+    }
+    fprintf(stdout, "%2ju bits: shifts and rotates match\n", widths[i]);
+  }
+
+  machine_state_free(ms);
+
+  return 0;
+}
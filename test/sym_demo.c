@@ -113,6 +113,7 @@ void gcd_symlist(machine_state *ms) {
 
 int main() {
   machine_state *ms = machine_state_init("sym_demo.c", 0, 24, 0x20000000, 32);
+  ms->vec_cow = 1; //Branch-heavy, share vector literals copy-on-write
   
   Vector **a = vec_getInputArray(ms, 8, 1*BITS_IN_BYTE, "a");
   Vector *a_address = vec_getConstant(ms, 0x1234, ms->memory.sMem->address_size);